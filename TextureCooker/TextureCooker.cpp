@@ -0,0 +1,357 @@
+//Offline texture cooker: decodes source images once, resizes them to TutorialProject's texture array layers, builds the full
+//mip chain, optionally block compresses it, and writes a .texcache file next to each source that TutorialProject memory maps and
+//copies into its layer directly.
+//Usage: TextureCooker [--compress] [--force] [--size n] [--flip] image... (--flip and --size apply to the images after them,
+//--no-flip turns flipping off, --size 0 keeps the source size)
+#include <image_loader_library/stb_image.h>
+#include "texture_cache_format.h"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <cstdlib>
+
+struct Image
+{
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+};
+
+//Next mip level, 2x2 box filter (matches what glGenerateMipmap produces), odd edges reuse the last row/column
+Image downsample(const Image& source)
+{
+    Image result;
+    result.width = std::max(1, source.width / 2);
+    result.height = std::max(1, source.height / 2);
+    result.pixels.resize((size_t)result.width * result.height * 4);
+    for (int y = 0; y < result.height; y++)
+    {
+        int y0 = std::min(y * 2, source.height - 1);
+        int y1 = std::min(y * 2 + 1, source.height - 1);
+        for (int x = 0; x < result.width; x++)
+        {
+            int x0 = std::min(x * 2, source.width - 1);
+            int x1 = std::min(x * 2 + 1, source.width - 1);
+            for (int c = 0; c < 4; c++)
+            {
+                int sum = source.pixels[((size_t)y0 * source.width + x0) * 4 + c]
+                    + source.pixels[((size_t)y0 * source.width + x1) * 4 + c]
+                    + source.pixels[((size_t)y1 * source.width + x0) * 4 + c]
+                    + source.pixels[((size_t)y1 * source.width + x1) * 4 + c];
+                result.pixels[((size_t)y * result.width + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+    return result;
+}
+
+//Pull a 4x4 block out of the image, clamping at the edges for sizes that aren't a multiple of 4
+void readBlock(const Image& image, int blockX, int blockY, unsigned char block[16][4])
+{
+    for (int y = 0; y < 4; y++)
+    {
+        int sy = std::min(blockY * 4 + y, image.height - 1);
+        for (int x = 0; x < 4; x++)
+        {
+            int sx = std::min(blockX * 4 + x, image.width - 1);
+            std::memcpy(block[y * 4 + x], &image.pixels[((size_t)sy * image.width + sx) * 4], 4);
+        }
+    }
+}
+
+std::uint16_t packRGB565(const int color[3])
+{
+    return (std::uint16_t)(((color[0] * 31 + 127) / 255) << 11 | ((color[1] * 63 + 127) / 255) << 5 | ((color[2] * 31 + 127) / 255));
+}
+
+void unpackRGB565(std::uint16_t packed, int color[3])
+{
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+//BC1 color block: bounding box endpoints inset slightly, each pixel gets the closest of the four palette colors
+void encodeColorBlock(const unsigned char block[16][4], unsigned char* out)
+{
+    int minColor[3] = { 255, 255, 255 };
+    int maxColor[3] = { 0, 0, 0 };
+    for (int i = 0; i < 16; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            minColor[c] = std::min(minColor[c], (int)block[i][c]);
+            maxColor[c] = std::max(maxColor[c], (int)block[i][c]);
+        }
+    }
+    for (int c = 0; c < 3; c++)
+    {
+        int inset = (maxColor[c] - minColor[c]) / 16;
+        minColor[c] += inset;
+        maxColor[c] -= inset;
+    }
+    std::uint16_t color0 = packRGB565(maxColor);
+    std::uint16_t color1 = packRGB565(minColor);
+    //Four color mode needs color0 > color1
+    if (color0 < color1)
+        std::swap(color0, color1);
+
+    int palette[4][3];
+    unpackRGB565(color0, palette[0]);
+    unpackRGB565(color1, palette[1]);
+    for (int c = 0; c < 3; c++)
+    {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    std::uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0;
+            int bestDistance = 1 << 30;
+            for (int p = 0; p < 4; p++)
+            {
+                int distance = 0;
+                for (int c = 0; c < 3; c++)
+                {
+                    int d = (int)block[i][c] - palette[p][c];
+                    distance += d * d;
+                }
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            indices |= (std::uint32_t)best << (i * 2);
+        }
+    }
+    out[0] = (unsigned char)(color0 & 0xFF);
+    out[1] = (unsigned char)(color0 >> 8);
+    out[2] = (unsigned char)(color1 & 0xFF);
+    out[3] = (unsigned char)(color1 >> 8);
+    for (int i = 0; i < 4; i++)
+        out[4 + i] = (unsigned char)(indices >> (i * 8));
+}
+
+//BC3 alpha block: min/max endpoints with the 8 value interpolated palette, 3 bit index per pixel
+void encodeAlphaBlock(const unsigned char block[16][4], unsigned char* out)
+{
+    int alpha0 = 0;
+    int alpha1 = 255;
+    for (int i = 0; i < 16; i++)
+    {
+        alpha0 = std::max(alpha0, (int)block[i][3]);
+        alpha1 = std::min(alpha1, (int)block[i][3]);
+    }
+    int palette[8];
+    palette[0] = alpha0;
+    palette[1] = alpha1;
+    for (int i = 1; i < 7; i++)
+        palette[i + 1] = ((7 - i) * alpha0 + i * alpha1) / 7;
+
+    std::uint64_t indices = 0;
+    if (alpha0 != alpha1)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0;
+            for (int p = 1; p < 8; p++)
+            {
+                if (std::abs((int)block[i][3] - palette[p]) < std::abs((int)block[i][3] - palette[best]))
+                    best = p;
+            }
+            indices |= (std::uint64_t)best << (i * 3);
+        }
+    }
+    out[0] = (unsigned char)alpha0;
+    out[1] = (unsigned char)alpha1;
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (unsigned char)(indices >> (i * 8));
+}
+
+std::vector<unsigned char> encodeLevel(const Image& image, std::uint32_t format)
+{
+    if (format == TEXTURE_CACHE_RGBA8)
+        return image.pixels;
+    int blocksX = (image.width + 3) / 4;
+    int blocksY = (image.height + 3) / 4;
+    size_t blockSize = format == TEXTURE_CACHE_BC1 ? 8 : 16;
+    std::vector<unsigned char> result((size_t)blocksX * blocksY * blockSize);
+    unsigned char block[16][4];
+    for (int by = 0; by < blocksY; by++)
+    {
+        for (int bx = 0; bx < blocksX; bx++)
+        {
+            readBlock(image, bx, by, block);
+            unsigned char* out = &result[((size_t)by * blocksX + bx) * blockSize];
+            if (format == TEXTURE_CACHE_BC3)
+            {
+                encodeAlphaBlock(block, out);
+                out += 8;
+            }
+            encodeColorBlock(block, out);
+        }
+    }
+    return result;
+}
+
+bool readCacheHeader(const std::string& path, TextureCacheHeader& header)
+{
+    std::ifstream file(path, std::ios::binary);
+    return file.read(reinterpret_cast<char*>(&header), sizeof(header)) && file.gcount() == sizeof(header);
+}
+
+//size is the width and height to cook at, 0 for the source's own
+bool cook(const std::string& sourcePath, bool compress, bool flip, int size, bool force)
+{
+    std::string cachePath = textureCachePath(sourcePath);
+    TextureCacheHeader existing;
+    if (!force && readCacheHeader(cachePath, existing) && textureCacheIsCurrent(existing, sourcePath)
+        && ((existing.flags & TEXTURE_CACHE_FLIPPED) != 0) == flip && existing.format == (compress ? TEXTURE_CACHE_BC3 : TEXTURE_CACHE_RGBA8)
+        && (size == 0 || (existing.width == (std::uint32_t)size && existing.height == (std::uint32_t)size)))
+    {
+        std::cout << sourcePath << ": up to date" << std::endl;
+        return true;
+    }
+
+    TextureSourceInfo source;
+    if (!readTextureSourceStat(sourcePath, source) || !hashTextureSource(sourcePath, source.hash))
+    {
+        std::cout << sourcePath << ": can't read source" << std::endl;
+        return false;
+    }
+
+    Image image;
+    int channels;
+    unsigned char* data = stbi_load(sourcePath.c_str(), &image.width, &image.height, &channels, 4);
+    if (!data)
+    {
+        std::cout << sourcePath << ": failed to decode" << std::endl;
+        return false;
+    }
+    if (size > 0 && (image.width != size || image.height != size))
+    {
+        image.pixels.resize((size_t)size * size * 4);
+        resizeTextureRGBA(data, image.width, image.height, image.pixels.data(), size, size);
+        image.width = size;
+        image.height = size;
+    }
+    else
+    {
+        image.pixels.assign(data, data + (size_t)image.width * image.height * 4);
+    }
+    stbi_image_free(data);
+    if (flip)
+    {
+        size_t rowSize = (size_t)image.width * 4;
+        for (int y = 0; y < image.height / 2; y++)
+            std::swap_ranges(image.pixels.begin() + y * rowSize, image.pixels.begin() + (y + 1) * rowSize, image.pixels.begin() + (image.height - 1 - y) * rowSize);
+    }
+
+    //BC3 even for opaque images, every layer of TutorialProject's texture array has to share one format
+    std::uint32_t format = compress ? TEXTURE_CACHE_BC3 : TEXTURE_CACHE_RGBA8;
+
+    std::vector<std::vector<unsigned char>> levelData;
+    std::vector<TextureCacheLevel> levels;
+    Image level = image;
+    while (true)
+    {
+        TextureCacheLevel info;
+        info.width = level.width;
+        info.height = level.height;
+        levelData.push_back(encodeLevel(level, format));
+        info.size = levelData.back().size();
+        levels.push_back(info);
+        if (level.width == 1 && level.height == 1)
+            break;
+        level = downsample(level);
+    }
+
+    TextureCacheHeader header;
+    std::memcpy(header.magic, TEXTURE_CACHE_MAGIC, 4);
+    header.version = TEXTURE_CACHE_VERSION;
+    header.format = format;
+    header.flags = flip ? TEXTURE_CACHE_FLIPPED : 0;
+    header.width = image.width;
+    header.height = image.height;
+    header.levelCount = (std::uint32_t)levels.size();
+    header.reserved = 0;
+    header.source = source;
+
+    std::uint64_t offset = sizeof(TextureCacheHeader) + levels.size() * sizeof(TextureCacheLevel);
+    for (TextureCacheLevel& info : levels)
+    {
+        offset = (offset + TEXTURE_CACHE_ALIGNMENT - 1) & ~(TEXTURE_CACHE_ALIGNMENT - 1);
+        info.offset = offset;
+        offset += info.size;
+    }
+
+    std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cout << cachePath << ": can't write" << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(levels.data()), levels.size() * sizeof(TextureCacheLevel));
+    std::uint64_t written = sizeof(TextureCacheHeader) + levels.size() * sizeof(TextureCacheLevel);
+    const char padding[TEXTURE_CACHE_ALIGNMENT] = {};
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        file.write(padding, (std::streamsize)(levels[i].offset - written));
+        file.write(reinterpret_cast<const char*>(levelData[i].data()), levelData[i].size());
+        written = levels[i].offset + levels[i].size;
+    }
+    const char* formatNames[] = { "RGBA8", "BC1", "BC3" };
+    std::cout << sourcePath << ": " << image.width << "x" << image.height << ", " << levels.size() << " levels, "
+        << formatNames[format] << ", " << written << " bytes -> " << cachePath << std::endl;
+    return (bool)file;
+}
+
+int main(int argc, char** argv)
+{
+    bool compress = false;
+    bool force = false;
+    bool flip = false;
+    int size = TEXTURE_LAYER_SIZE;
+    int failures = 0;
+    int cooked = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        if (argument == "--compress")
+            compress = true;
+        else if (argument == "--force")
+            force = true;
+        else if (argument == "--flip")
+            flip = true;
+        else if (argument == "--no-flip")
+            flip = false;
+        else if (argument == "--size" && i + 1 < argc)
+            size = std::max(0, std::atoi(argv[++i]));
+        else
+        {
+            if (!cook(argument, compress, flip, size, force))
+                failures++;
+            cooked++;
+        }
+    }
+    if (cooked == 0)
+    {
+        std::cout << "Usage: TextureCooker [--compress] [--force] [--size n] [--flip | --no-flip] image..." << std::endl;
+        return 1;
+    }
+    return failures == 0 ? 0 : 1;
+}
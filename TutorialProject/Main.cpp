@@ -5,20 +5,231 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <image_loader_library/stb_image.h>
 #include "shader_s.h"
+#include "shader_variants.h"
 #include "camera.h"
+#include "frame_uniforms.h"
+#include "mesh.h"
+#include "mesh_lod.h"
+#include "thread_pool.h"
+#include "texture_array.h"
+#include "material_table.h"
+#include "culling.h"
+#include "render_target.h"
+#include "benchmark.h"
+#include "profiler.h"
+#include "text_overlay.h"
+#include "stream_buffer.h"
+#include "gl_extensions.h"
+#include "render_state.h"
+#include "light_grid.h"
+#include "occlusion.h"
+#include "frame_pacing.h"
+#include "batch_transform.h"
+#include "mesh_import.h"
+#include "indirect_draw.h"
+#include "dynamic_resolution.h"
 
 #include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <sstream>
+#include <future>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <cmath>
+
+//Per light cube data, drawn instanced in each light's color
+struct LightInstance
+{
+    glm::mat4 model;
+    glm::vec4 color;
+};
+
+//Everything the GL thread needs to submit one frame. updateScene fills it on the thread pool, the GL thread only reads it afterwards
+struct FramePacket
+{
+    //Inputs, copied on the GL thread before the update starts so the jobs never touch live state
+    Camera camera;
+    float time = 0.0f;
+    //GPU clock when the input this packet's camera comes from was read, for input to present latency
+    GLint64 inputTimestamp = 0;
+    bool frustumCulling = true;
+    bool sortFrontToBack = false;
+    unsigned int lightCount = 1;
+    //Output width over height for the projection, and the height the scene renders at for LOD selection
+    float aspectRatio = 1.0f;
+    float renderHeight = 1.0f;
+    //Cube LOD thresholds over every level of the cube mesh
+    LodSelector lodSelector;
+    //Off puts every cube on the coarsest level, the original 12 triangle cube, so runs without LOD draw what they did before
+    //the cube was tessellated
+    bool lodSelection = true;
+    //Newest Hi-Z readback when occlusion culling is on, null otherwise
+    std::shared_ptr<const DepthPyramid> depthPyramid;
+    //Outputs
+    FrameUniforms uniforms;
+    std::vector<PointLight> lights;
+    std::vector<LightInstance> lightInstances;
+    //Clusters and their light lists, uploaded as is by the GL thread
+    LightGrid lightGrid;
+    //Grouped by LOD, lodCounts[l] cubes using LOD l follow the ones using finer levels
+    std::vector<unsigned int> visibleCubes;
+    std::vector<unsigned int> lodCounts;
+    //Model and normal matrix for each visible cube, fed to either draw path
+    std::vector<InstanceTransform> instances;
+    CullingStats cullingStats;
+    //Per job culling results, merged into visibleCubes
+    std::vector<std::vector<unsigned int>> chunkVisible;
+    std::vector<CullingStats> chunkStats;
+    //Per visible cube, set when the depth pyramid hides it
+    std::vector<unsigned char> occluded;
+    //(distance squared, cube) pairs for front to back sorting
+    std::vector<std::pair<float, unsigned int>> depthOrder;
+    //Scratch for grouping visibleCubes by LOD
+    std::vector<unsigned int> lodOrder;
+};
 
 void processInput(GLFWwindow* window);
+void simulateStep(GLFWwindow* window, float step);
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
+glm::mat4 cubeModelMatrix(unsigned int index, const glm::vec3& position, float time);
+void buildCubeTransforms(TransformBatch& batch, const std::vector<glm::vec3>& positions, unsigned int materialCount);
+int runTransformBenchmark();
+bool keyPressedOnce(GLFWwindow* window, int key, bool& wasDown);
+void scriptedCamera(unsigned int frame, unsigned int frameCount);
+void updateScene(FramePacket& packet, const std::vector<glm::vec3>& cubePositions, const TransformBatch& cubeTransforms, SceneGrid& cubeGrid, std::vector<unsigned char>& cubeLods, ThreadPool& threadPool);
+void setInstanceAttributes(RenderState& state, unsigned int VAO, unsigned int buffer, size_t offset, size_t stride, bool normalMatrix);
+void setLightInstanceAttributes(RenderState& state, unsigned int VAO, unsigned int buffer, size_t offset);
+unsigned int cubeShaderFeatures(const MaterialTable& materialTable);
+Material firstMaterial(unsigned int layer1, unsigned int layer2);
 
 //Settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
+//Total cubes in the scene, the first 10 are the hand placed ones, the rest fill a field behind them
+const unsigned int CUBE_COUNT = 10000;
+//Cubes only spin in place, so a sphere around the unit cube bounds them at any rotation
+const float CUBE_BOUNDING_RADIUS = 0.8660254f;
+//The cube's faces are split into a CUBE_TESSELLATION x CUBE_TESSELLATION grid for LOD 0, standing in for a real mesh with enough
+//triangles to be worth simplifying. Coarser levels are simplified from it, the last is the original 12 triangle cube
+const unsigned int CUBE_TESSELLATION = 8;
+const unsigned int CUBE_LOD_LEVELS = 4;
+//Projection depth range, shared by the camera, draw sort keys and the light grid
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 100.0f;
+
+//Draw cubes with one instanced call instead of one draw per cube, toggled with I
+bool useInstancing = true;
+bool instancingKeyDown = false;
+//Instanced draws go out as indirect commands, one multi-draw for every pooled mesh where the context has it. Toggled with M,
+//off from the start with --no-indirect. Needs GL_ARB_base_instance, without it the instanced path draws per LOD as before
+bool useIndirect = true;
+bool indirectKeyDown = false;
+//Skip cubes outside the view frustum, toggled with C
+bool useFrustumCulling = true;
+bool cullingKeyDown = false;
+//Also skip cubes hidden behind the depth of a frame a few frames back, toggled with O or on from the start with --occlusion.
+//Cubes that come into view are drawn again once a readback that sees them lands, a couple of frames later
+bool useOcclusionCulling = false;
+bool occlusionKeyDown = false;
+//Draw distant cubes with coarser LODs picked from their projected size, toggled with K or off from the start with --no-lod.
+//Off, every cube draws the original 12 triangle cube
+bool useLod = true;
+bool lodKeyDown = false;
+//Build frame N+1's culling results and matrices on the thread pool while frame N is submitted, toggled with U.
+//Costs a frame of input latency since the update runs on the camera as it was a frame earlier
+bool pipelinedUpdate = true;
+bool pipelineKeyDown = false;
+//Per-section timing overlay, toggled with P. T writes the recorded frames to traceOutput as a Chrome trace
+bool showProfilerOverlay = true;
+bool overlayKeyDown = false;
+bool traceKeyDown = false;
+bool writeTraceNow = false;
+bool traceRequested = false;
+std::string traceOutput = "profile_trace.json";
+//Rebuild shaders when their files change, checked once a second. Toggled with H, on from the start with --watch-shaders
+bool watchShaders = false;
+bool watchShadersKeyDown = false;
+//Dynamic resolution: the scene renders at the scale ResolutionController picks to keep GPU time under frameBudgetMilliseconds,
+//then gets upscaled to the window. Toggled with R, off it renders at resolutionScale. Benchmarks only turn it on with
+//--frame-budget ms, --resolution-scale s fixes the scale
+bool dynamicResolution = true;
+bool dynamicResolutionKeyDown = false;
+double frameBudgetMilliseconds = 16.0;
+float resolutionScale = 1.0f;
+//Texture array in BC3 instead of RGBA8, from --compressed-textures. Every texture then has to be cooked with TextureCooker --compress
+bool compressedTextures = false;
+//Window framebuffer size, kept up to date by framebuffer_size_callback
+int framebufferWidth = SCR_WIDTH;
+int framebufferHeight = SCR_HEIGHT;
+
+//Keyboard movement and animation advance in fixed steps of this many seconds, rendering interpolates between the last two
+const double SIMULATION_STEP = 1.0 / 120.0;
+//Frame pacing: --swap-interval n sets vsync for windowed runs (0 off, 1 every refresh), --fps n caps the frame rate, 0 doesn't.
+//Vsync off with a cap a little under the refresh rate usually has the lowest latency
+int swapInterval = 1;
+double targetFps = 0.0;
+
+//Headless benchmark settings, set from the command line (--headless, --benchmark [frames], --output file, --per-draw, --no-indirect, --no-culling, --occlusion, --no-lod,
+//--serial-update, --watch-shaders, --lights n, --swap-interval n, --fps n, --depth-mode unsorted|front-to-back|prepass, --frame-budget ms, --resolution-scale s,
+//--compressed-textures).
+//--trace file also writes a Chrome trace of the last frames on exit, --transform-benchmark times the matrix paths and exits
+bool headless = false;
+unsigned int benchmarkFrames = 0;
+const unsigned int BENCHMARK_WARMUP_FRAMES = 30;
+std::string benchmarkOutput = "benchmark.json";
+bool transformBenchmark = false;
+//Model file (.glb or .obj) drawn with the cube shader in front of the cubes, from --model
+std::string modelPath;
+//Imported models are scaled to fit a cube of this size and centered here
+const float MODEL_SIZE = 2.0f;
+const glm::vec3 MODEL_POSITION = glm::vec3(0.0f, 0.0f, -5.0f);
+//Imported models use the first material, same as the first cubes
+const unsigned int MODEL_MATERIAL = 0;
+//Draw calls and triangles submitted this frame
+FrameStats frameStats;
+
+//Cube shader permutations, bit i defines CUBE_SHADER_DEFINES[i] in shader.vs/shader.fs to skip work the cubes don't need
+const unsigned int CUBE_NO_TEXTURE1 = 1 << 0;
+const unsigned int CUBE_NO_TEXTURE2 = 1 << 1;
+const unsigned int CUBE_NO_VERTEX_COLOR = 1 << 2;
+const unsigned int CUBE_SPECULAR_OFF = 1 << 3;
+const unsigned int CUBE_SINGLE_LIGHT = 1 << 4;
+const std::vector<std::string> CUBE_SHADER_DEFINES = { "NO_TEXTURE1", "NO_TEXTURE2", "NO_VERTEX_COLOR", "SPECULAR_OFF", "SINGLE_LIGHT" };
+//Tint cubes with their vertex colors, toggled with V
+bool useVertexColors = true;
+bool vertexColorKeyDown = false;
 
-//Texture mixing value
+//How the cubes deal with overdraw, cycled with Z or set with --depth-mode: drawn in cube order, sorted front to back by
+//camera distance so early-Z rejects more, or a depth-only pre-pass followed by shading with GL_EQUAL
+const unsigned int DEPTH_UNSORTED = 0;
+const unsigned int DEPTH_FRONT_TO_BACK = 1;
+const unsigned int DEPTH_PREPASS = 2;
+const char* const DEPTH_MODE_NAMES[] = { "unsorted", "front-to-back", "prepass" };
+unsigned int depthMode = DEPTH_UNSORTED;
+bool depthModeKeyDown = false;
+
+//Point lights in the scene. The first is the original orbiting light, the rest orbit through the cube field and are shaded
+//through the light grid. L switches between 1 and manyLightCount, --lights n starts with n
+unsigned int lightCount = 1;
+unsigned int manyLightCount = 256;
+bool lightsKeyDown = false;
+//Texture units the light grid, the texture array and the material table stay bound to for the whole run
+const unsigned int LIGHT_GRID_UNIT = 2;
+const unsigned int TEXTURE_ARRAY_UNIT = 3;
+const unsigned int MATERIAL_UNIT = 4;
+
+//Texture set ids for draw sort keys, draws sharing one also share every bound texture. Cube and model textures come from
+//the texture array, so those draws bind none of their own
+const unsigned int NO_TEXTURE_SET = 0;
+
+//Texture mixing value of the first material, the UP/DOWN keys change it
 float mixValue = 0.2f;
 
 //Vectors for camera definition
@@ -34,17 +245,105 @@ float lastY = SCR_HEIGHT / 2.0;
 float lastFrame = 0.0;
 float deltaTime = 0.0;
 
-//Light color
+//Light color, and the light strengths of the first material
 glm::vec3 lightColor(1.0f, 1.0f, 1.0f);
 float ambientLightStrength = 0.1f;
 float specularLightStrength = 0.5f;
 
-int main()
+int main(int argc, char** argv)
 {
+#ifdef BENCHMARK_BUILD
+    //The Benchmark project runs the scripted benchmark unless told otherwise
+    benchmarkFrames = 1000;
+    headless = true;
+#endif
+    bool frameBudgetSet = false;
+    bool resolutionScaleSet = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--headless") == 0)
+            headless = true;
+        else if (std::strcmp(argv[i], "--benchmark") == 0)
+        {
+            headless = true;
+            benchmarkFrames = 1000;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                benchmarkFrames = (unsigned int)std::strtoul(argv[++i], NULL, 10);
+        }
+        else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            benchmarkOutput = argv[++i];
+        else if (std::strcmp(argv[i], "--per-draw") == 0)
+            useInstancing = false;
+        else if (std::strcmp(argv[i], "--no-indirect") == 0)
+            useIndirect = false;
+        else if (std::strcmp(argv[i], "--no-culling") == 0)
+            useFrustumCulling = false;
+        else if (std::strcmp(argv[i], "--occlusion") == 0)
+            useOcclusionCulling = true;
+        else if (std::strcmp(argv[i], "--no-lod") == 0)
+            useLod = false;
+        else if (std::strcmp(argv[i], "--serial-update") == 0)
+            pipelinedUpdate = false;
+        else if (std::strcmp(argv[i], "--watch-shaders") == 0)
+            watchShaders = true;
+        else if (std::strcmp(argv[i], "--depth-mode") == 0 && i + 1 < argc)
+        {
+            i++;
+            for (unsigned int mode = DEPTH_UNSORTED; mode <= DEPTH_PREPASS; mode++)
+            {
+                if (std::strcmp(argv[i], DEPTH_MODE_NAMES[mode]) == 0)
+                    depthMode = mode;
+            }
+        }
+        else if (std::strcmp(argv[i], "--lights") == 0 && i + 1 < argc)
+        {
+            lightCount = (unsigned int)std::strtoul(argv[++i], NULL, 10);
+            lightCount = lightCount < 1 ? 1 : (lightCount > LightGrid::MAX_LIGHTS ? LightGrid::MAX_LIGHTS : lightCount);
+            if (lightCount > 1)
+                manyLightCount = lightCount;
+        }
+        else if (std::strcmp(argv[i], "--swap-interval") == 0 && i + 1 < argc)
+            swapInterval = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+            targetFps = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            traceOutput = argv[++i];
+            traceRequested = true;
+        }
+        else if (std::strcmp(argv[i], "--transform-benchmark") == 0)
+            transformBenchmark = true;
+        else if (std::strcmp(argv[i], "--model") == 0 && i + 1 < argc)
+            modelPath = argv[++i];
+        else if (std::strcmp(argv[i], "--frame-budget") == 0 && i + 1 < argc)
+        {
+            frameBudgetMilliseconds = std::atof(argv[++i]);
+            frameBudgetSet = true;
+        }
+        else if (std::strcmp(argv[i], "--resolution-scale") == 0 && i + 1 < argc)
+        {
+            resolutionScale = std::min(std::max((float)std::atof(argv[++i]), 0.25f), 1.0f);
+            resolutionScaleSet = true;
+        }
+        else if (std::strcmp(argv[i], "--compressed-textures") == 0)
+            compressedTextures = true;
+    }
+    //Micro-benchmark of the CPU transform paths, needs no window
+    if (transformBenchmark)
+        return runTransformBenchmark();
+    bool benchmarking = benchmarkFrames > 0;
+    //Benchmarks compare runs, so they keep a fixed resolution unless given a budget
+    if (resolutionScaleSet || (benchmarking && !frameBudgetSet))
+        dynamicResolution = false;
+
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    //Headless runs keep the window hidden and draw into an offscreen framebuffer instead.
+    //On a Linux box without a GPU run under xvfb-run with LIBGL_ALWAYS_SOFTWARE=1 to get Mesa's llvmpipe
+    if (headless)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
     //Create window object
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
@@ -59,6 +358,8 @@ int main()
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetScrollCallback(window, scroll_callback);
+    //Can differ from the window size on high DPI screens
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
     //Set cursor to be locked and disappear for capture
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
@@ -68,69 +369,69 @@ int main()
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    loadGLExtensionFunctions((GLADloadproc)glfwGetProcAddress);
+    //Don't let vsync cap headless runs
+    glfwSwapInterval(headless ? 0 : swapInterval);
 
-    //Build shader object for texture cubes
-    Shader ourShader("shader.vs", "shader.fs");
-    //Build shader object for light cube
-    Shader lightShader("light_shader.vs", "light_shader.fs");
-    //Vertices for light cube
-    float lightVertices[] = {
-    -0.5f, -0.5f, -0.5f,
-     0.5f, -0.5f, -0.5f,
-     0.5f,  0.5f, -0.5f,
-     0.5f,  0.5f, -0.5f,
-    -0.5f,  0.5f, -0.5f,
-    -0.5f, -0.5f, -0.5f,
-
-    -0.5f, -0.5f,  0.5f,
-     0.5f, -0.5f,  0.5f,
-     0.5f,  0.5f,  0.5f,
-     0.5f,  0.5f,  0.5f,
-    -0.5f,  0.5f,  0.5f,
-    -0.5f, -0.5f,  0.5f,
-
-    -0.5f,  0.5f,  0.5f,
-    -0.5f,  0.5f, -0.5f,
-    -0.5f, -0.5f, -0.5f,
-    -0.5f, -0.5f, -0.5f,
-    -0.5f, -0.5f,  0.5f,
-    -0.5f,  0.5f,  0.5f,
-
-     0.5f,  0.5f,  0.5f,
-     0.5f,  0.5f, -0.5f,
-     0.5f, -0.5f, -0.5f,
-     0.5f, -0.5f, -0.5f,
-     0.5f, -0.5f,  0.5f,
-     0.5f,  0.5f,  0.5f,
-
-    -0.5f, -0.5f, -0.5f,
-     0.5f, -0.5f, -0.5f,
-     0.5f, -0.5f,  0.5f,
-     0.5f, -0.5f,  0.5f,
-    -0.5f, -0.5f,  0.5f,
-    -0.5f, -0.5f, -0.5f,
-
-    -0.5f,  0.5f, -0.5f,
-     0.5f,  0.5f, -0.5f,
-     0.5f,  0.5f,  0.5f,
-     0.5f,  0.5f,  0.5f,
-    -0.5f,  0.5f,  0.5f,
-    -0.5f,  0.5f, -0.5f
-    };
-    //VAO and VBO for light cube
-    unsigned int lightVAO;
-    glGenVertexArrays(1, &lightVAO);
-    glBindVertexArray(lightVAO);
-    unsigned int lightVBO;
-    glGenBuffers(1, &lightVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, lightVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(lightVertices), lightVertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3*sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    //Every program, VAO, texture and capability change from here on goes through this so repeats are skipped
+    RenderState renderState;
 
+    //Worker threads for the scene update, texture decoding and model import
+    ThreadPool threadPool;
+    //Every texture is a layer of one array and every object picks its layers and light strengths through a material, so
+    //differently textured cubes still draw as one batch. Cooked textures are in right away, decoding starts now and overlaps the shader compiles
+    if (compressedTextures && !hasGLExtension("GL_EXT_texture_compression_s3tc"))
+    {
+        std::cout << "ERROR::TEXTURE_ARRAY::NO_S3TC falling back to RGBA8" << std::endl;
+        compressedTextures = false;
+    }
+    TextureLoader textureLoader(threadPool);
+    TextureArray textureArray(textureLoader, compressedTextures ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_RGBA8);
+    unsigned int containerLayer = textureArray.add("container.jpg");
+    unsigned int faceLayer = textureArray.add("face.png", true);
+    MaterialTable materialTable;
+    materialTable.create();
+    materialTable.add(firstMaterial(containerLayer, faceLayer));
+    {
+        Material container;
+        container.layer1 = containerLayer;
+        container.layer2 = containerLayer;
+        container.specularStrength = 0.2f;
+        materialTable.add(container);
+        Material face;
+        face.layer1 = faceLayer;
+        face.layer2 = faceLayer;
+        face.ambientStrength = 0.2f;
+        face.specularStrength = 1.0f;
+        materialTable.add(face);
+        Material swapped;
+        swapped.layer1 = faceLayer;
+        swapped.layer2 = containerLayer;
+        swapped.mixValue = 0.5f;
+        swapped.specularStrength = 0.0f;
+        materialTable.add(swapped);
+    }
+    materialTable.upload();
+
+    //Build shader objects for texture cubes and light cube. Compiles are only started here and finished after the
+    //buffers are set up, so a driver with parallel compiles works on them meanwhile. Cached binaries skip compiling entirely
+    double shaderBuildStart = glfwGetTime();
+    //Cube shader variants, one per feature mask. Each is set up once when it's built and again when reloaded
+    ShaderVariants cubeShaders("shader.vs", "shader.fs", CUBE_SHADER_DEFINES, [&renderState](Shader& shader) {
+        //Per-frame camera and light data shared by every shader through one uniform block, written into the stream buffer
+        shader.bindUniformBlock("FrameData", FRAME_UNIFORMS_BINDING);
+        //Set constant uniforms, tie texture IDs to uniforms
+        renderState.useProgram(shader.shaderProgram);
+        shader.setInt("textures", TEXTURE_ARRAY_UNIT);
+        shader.setInt("materials", MATERIAL_UNIT);
+        shader.setInt("lightGrid", LIGHT_GRID_UNIT);
+    }, FRAME_DATA_GLSL);
+    //The starting variant and the one L switches to. The mix keys only move the first material, the others keep both layers in use
+    unsigned int startFeatures = cubeShaderFeatures(materialTable);
+    cubeShaders.prepare(startFeatures);
+    cubeShaders.prepare(startFeatures ^ CUBE_SINGLE_LIGHT);
+    Shader lightShader("light_shader.vs", "light_shader.fs", false, std::vector<std::string>(), FRAME_DATA_GLSL);
+    Shader depthShader("depth.vs", "depth.fs", false, std::vector<std::string>(), FRAME_DATA_GLSL);
     //Triangle vertices for VBO, attributes, in order: position, color, texture coords, normals
     float vertices[] = {
     -0.5f, -0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f,
@@ -176,7 +477,7 @@ int main()
     -0.5f,  0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f,  0.0f
     };
     //Positions for each cube of vertices
-    glm::vec3 cubePositions[] = {
+    std::vector<glm::vec3> cubePositions = {
     glm::vec3(0.0f,  0.0f,  0.0f),
     glm::vec3(1.5f,  0.2f, -1.5f),
     glm::vec3(2.0f,  5.0f, -15.0f),   
@@ -188,213 +489,1231 @@ int main()
     glm::vec3(1.5f,  2.0f, -2.5f),
     glm::vec3(-1.3f,  1.0f, -1.5f)
     };
+    //Fill the rest of the field with cubes scattered behind the hand placed ones
+    srand(1337);
+    while (cubePositions.size() < CUBE_COUNT)
+    {
+        float x = (rand() / (float)RAND_MAX) * 80.0f - 40.0f;
+        float y = (rand() / (float)RAND_MAX) * 80.0f - 40.0f;
+        float z = (rand() / (float)RAND_MAX) * -70.0f - 20.0f;
+        cubePositions.push_back(glm::vec3(x, y, z));
+    }
+    //Bounding spheres never move, so the grid never needs rebuilding
+    std::vector<float> cubeRadii(cubePositions.size(), CUBE_BOUNDING_RADIUS);
+    SceneGrid cubeGrid;
+    cubeGrid.build(cubePositions, cubeRadii, 10.0f);
+    TransformBatch cubeTransforms;
+    buildCubeTransforms(cubeTransforms, cubePositions, (unsigned int)materialTable.size());
 
-    //Define Vertex Array Object and bind
-    unsigned int VAO;
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-    //Define Vertex Buffer Object, bind to GL_ARRAY_BUFFER
-    unsigned int VBO;
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    //Load vertex information into GPU memory in buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    //How to interpret vertex data (per vertex attribute)
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-    //Enable the vertex attribute
-    glEnableVertexAttribArray(0);
-    //Texture attribute
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    //Color attribute
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    //Normal attribute
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(8 * sizeof(float)));
-    glEnableVertexAttribArray(3);
-
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    //Load in textures
-    unsigned int texture1;
-    glGenTextures(1, &texture1);
-    glBindTexture(GL_TEXTURE_2D, texture1);
-    //Set texture wrap/mipmap properties
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    //Generate texture
-    int width, height, nrChannels;
-    unsigned char* data = stbi_load("container.jpg", &width, &height, &nrChannels, 0);
-    if (data)
-    {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+    //Deduplicate the triangle lists of every LOD into one indexed mesh with packed attributes
+    std::vector<MeshVertex> cubeTriangles;
+    for (unsigned int i = 0; i < sizeof(vertices) / sizeof(float); i += 11)
+    {
+        MeshVertex vertex;
+        vertex.position = glm::vec3(vertices[i], vertices[i + 1], vertices[i + 2]);
+        vertex.color = glm::vec3(vertices[i + 3], vertices[i + 4], vertices[i + 5]);
+        vertex.texCoord = glm::vec2(vertices[i + 6], vertices[i + 7]);
+        vertex.normal = glm::vec3(vertices[i + 8], vertices[i + 9], vertices[i + 10]);
+        cubeTriangles.push_back(vertex);
     }
-    else
+    MeshBuilder cubeBuilder;
+    //Simplified levels start at twice the tessellated grid's spacing
+    addLodChain(cubeBuilder, tessellateQuads(cubeTriangles, CUBE_TESSELLATION), 2.0f / CUBE_TESSELLATION, CUBE_LOD_LEVELS - 1);
+    cubeBuilder.beginLod();
+    for (const MeshVertex& vertex : cubeTriangles)
+        cubeBuilder.addVertex(vertex);
+    //Every mesh the cube shader draws shares one set of buffers, so the instanced ones can all go out in one multi-draw
+    MeshPool meshPool;
+    meshPool.add(cubeBuilder);
+    //Model from --model. OBJs join the pool, glTF binaries keep the buffers they were uploaded into straight from the file
+    ImportedModel importedModel;
+    MeshBuilder modelBuilder;
+    int pooledModel = -1;
+    glm::mat4 importedModelMatrix = glm::mat4(1.0f);
+    glm::mat3 importedNormalMatrix = glm::mat3(1.0f);
+    if (!modelPath.empty())
     {
-        std::cout << "Failed to load texture" << std::endl;
+        double importStart = glfwGetTime();
+        bool imported = false;
+        std::string extension = fileExtension(modelPath);
+        if (extension == "obj")
+        {
+            imported = loadObj(modelPath, threadPool, modelBuilder, importedModel);
+            if (imported)
+            {
+                pooledModel = (int)meshPool.add(modelBuilder);
+                importedModel.vertexBytes = modelBuilder.vertices.size() * sizeof(PackedVertex);
+                importedModel.indexBytes = modelBuilder.indices.size() * sizeof(unsigned int);
+                importedModel.triangles = modelBuilder.indices.size() / 3;
+            }
+        }
+        else if (extension == "glb")
+        {
+            imported = importGlb(modelPath, importedModel);
+        }
+        else
+        {
+            std::cout << "ERROR::MESH_IMPORT::UNKNOWN_FORMAT " << modelPath << std::endl;
+        }
+        if (imported)
+        {
+            glm::vec3 extent = importedModel.boundsMax - importedModel.boundsMin;
+            float largest = std::max(extent.x, std::max(extent.y, extent.z));
+            float scale = largest > 0.0f ? MODEL_SIZE / largest : 1.0f;
+            importedModelMatrix = glm::translate(glm::mat4(1.0f), MODEL_POSITION);
+            importedModelMatrix = glm::scale(importedModelMatrix, glm::vec3(scale));
+            importedModelMatrix = glm::translate(importedModelMatrix, -(importedModel.boundsMin + importedModel.boundsMax) * 0.5f);
+            importedNormalMatrix = glm::transpose(glm::inverse(glm::mat3(importedModelMatrix)));
+            std::cout << "Model " << modelPath << ": " << (pooledModel >= 0 ? 1 : importedModel.meshes.size()) << " meshes, " << importedModel.triangles << " triangles, "
+                << importedModel.vertexBytes << " vertex + " << importedModel.indexBytes << " index bytes in "
+                << (glfwGetTime() - importStart) * 1000.0 << " ms" << std::endl;
+        }
     }
-    stbi_image_free(data);
+    meshPool.upload();
+    Mesh cubeMesh = meshPool.meshes[0];
+    //Model meshes drawn one by one, the pooled one last so the indirect path can leave it out
+    std::vector<Mesh> modelMeshes = importedModel.meshes;
+    if (pooledModel >= 0)
+        modelMeshes.push_back(meshPool.meshes[pooledModel]);
+    IndirectDrawList indirectDraws;
+    size_t maxIndirectCommands = cubeMesh.lods.size() + (pooledModel >= 0 ? meshPool.meshes[pooledModel].lods.size() : 0);
+    const MeshLod& lightLod = cubeMesh.lods.back();
+    //Every cube starts at LOD 0, updateScene keeps what each one used last so the hysteresis has something to go on
+    std::vector<unsigned char> cubeLods(cubePositions.size(), 0);
+    //Light cube reads the positions straight out of the cube mesh's buffers
+    unsigned int lightVAO = createPositionOnlyVAO(cubeMesh);
+    //Depth pre-pass only needs positions, so it reads a narrower vertex stream than the shading pass
+    unsigned int depthVAO = createPositionOnlyVAO(cubeMesh);
+    //Report memory before (float triangle list for the cube, separate position only list for the light) and after. After is
+    //the original cube, the coarsest LOD, packed on its own; the finer levels didn't exist before and are reported separately
+    MeshBuilder originalCube;
+    for (const MeshVertex& vertex : cubeTriangles)
+        originalCube.addVertex(vertex);
+    size_t originalVertexBytes = originalCube.vertices.size() * sizeof(PackedVertex);
+    size_t originalIndexBytes = originalCube.indices.size() * (originalCube.vertices.size() <= 0xFFFF ? sizeof(unsigned short) : sizeof(unsigned int));
+    size_t bytesBefore = sizeof(vertices) + 36 * 3 * sizeof(float);
+    size_t bytesAfter = originalVertexBytes + originalIndexBytes;
+    std::cout << "Cube mesh: " << sizeof(vertices) << " bytes -> " << bytesAfter << " bytes (" << originalCube.vertices.size() << " vertices, "
+        << originalVertexBytes << " vertex + " << originalIndexBytes << " index bytes)" << std::endl;
+    std::cout << "Light cube mesh: " << 36 * 3 * sizeof(float) << " bytes -> 0 bytes (shares cube buffers, coarsest LOD)" << std::endl;
+    std::cout << "Total: " << bytesBefore << " bytes -> " << bytesAfter << " bytes" << std::endl;
+    std::cout << "Cube LODs:";
+    for (const MeshLod& lod : cubeMesh.lods)
+        std::cout << " " << lod.indexCount / 3;
+    std::cout << " triangles, " << cubeMesh.vertexBytes + cubeMesh.indexBytes - bytesAfter << " extra bytes for the finer levels ("
+        << cubeBuilder.vertices.size() << " vertices, " << cubeMesh.vertexBytes << " vertex + " << cubeMesh.indexBytes << " index bytes in all)" << std::endl;
 
-    unsigned int texture2;
-    glGenTextures(1, &texture2);
-    glBindTexture(GL_TEXTURE_2D, texture2);
-    //Set texture wrap/mipmap properties
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    //Generate texture
-    stbi_set_flip_vertically_on_load(true);
-    data = stbi_load("face.png", &width, &height, &nrChannels, 0);
-    if (data)
+    //Per-frame transforms and camera data are written into a ring of fenced regions instead of respecified buffers or uniforms.
+    //One region holds a frame's worth: every cube's matrices, the light cubes and the FrameData block
+    int uniformAlignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+    StreamBuffer streamBuffer;
+    size_t batchBytes = (cubePositions.size() + 1) * sizeof(InstanceTransform) + maxIndirectCommands * sizeof(DrawElementsIndirectCommand);
+    if (!streamBuffer.create(batchBytes + LightGrid::MAX_LIGHTS * sizeof(LightInstance) + sizeof(FrameUniforms) + 4 * (size_t)uniformAlignment))
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        glfwTerminate();
+        return -1;
     }
-    else
+    std::cout << "Stream buffer: " << (streamBuffer.persistent ? "persistent mapped" : "unsynchronized map") << std::endl;
+    std::cout << "Indirect draws: " << (IndirectDrawList::multiDraw() ? "multi-draw" : IndirectDrawList::available() ? "base instance draws" : "unavailable, per LOD instanced draws") << std::endl;
+    //Instance attributes read from the stream buffer, repointed at this frame's allocation before each draw
+    setInstanceAttributes(renderState, cubeMesh.VAO, streamBuffer.buffer, 0, sizeof(InstanceTransform), true);
+    setLightInstanceAttributes(renderState, lightVAO, streamBuffer.buffer, 0);
+    setInstanceAttributes(renderState, depthVAO, streamBuffer.buffer, 0, sizeof(InstanceTransform), false);
+    renderState.bindVertexArray(0);
+    //Light grid gets its own ring, the buffer texture over it stays bound for the whole run and only the offsets change
+    LightGridBuffer lightGridBuffer;
+    if (!lightGridBuffer.create())
     {
-        std::cout << "Failed to load texture" << std::endl;
-    }
-    stbi_image_free(data);
-
-    
-    //Set constant uniforms
-    lightShader.use();
-    lightShader.setVec3("lightColor", lightColor);
-    ourShader.use();
-    ourShader.setVec3("lightColor", lightColor);
-    ourShader.setFloat("specularLightStrength", specularLightStrength);
-    ourShader.setFloat("ambientLightStrength", ambientLightStrength);
-    //Tie texture IDs to uniforms
-    ourShader.setInt("texture1", 0);
-    ourShader.setInt("texture2", 1);
+        glfwTerminate();
+        return -1;
+    }
+    glActiveTexture(GL_TEXTURE0 + LIGHT_GRID_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, lightGridBuffer.texture);
+    //Same for the textures and materials, layers and table entries change underneath without rebinding
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_ARRAY_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray.texture);
+    glActiveTexture(GL_TEXTURE0 + MATERIAL_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, materialTable.texture);
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture1);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, texture2);
-    //Enable depth testing
-    glEnable(GL_DEPTH_TEST);
+
+    cubeShaders.finish();
+    lightShader.finish();
+    lightShader.bindUniformBlock("FrameData", FRAME_UNIFORMS_BINDING);
+    depthShader.finish();
+    depthShader.bindUniformBlock("FrameData", FRAME_UNIFORMS_BINDING);
+    UniformHandle depthModelUniform = depthShader.uniform("model");
+    UniformHandle depthInstancedUniform = depthShader.uniform("instanced");
+    double shaderBuildMilliseconds = (glfwGetTime() - shaderBuildStart) * 1000.0;
+    std::cout << "Shaders ready in " << shaderBuildMilliseconds << " ms" << (parallelShaderCompile() ? " (parallel compile)" : "") << std::endl;
+
+    //Headless runs render into this instead of the hidden window's framebuffer
+    RenderTarget offscreenTarget;
+    if (headless && !offscreenTarget.create(SCR_WIDTH, SCR_HEIGHT))
+    {
+        glfwTerminate();
+        return -1;
+    }
+
+    //The scene renders into this and is upscaled to the window, or offscreenTarget when headless. It's kept at the output size
+    //and lower scales only draw into its bottom left corner, which is also all the Hi-Z reduces, so a scale change reallocates nothing
+    RenderTarget sceneTarget;
+    if (!sceneTarget.create(headless ? SCR_WIDTH : std::max(framebufferWidth, 1), headless ? SCR_HEIGHT : std::max(framebufferHeight, 1)))
+    {
+        glfwTerminate();
+        return -1;
+    }
+    ResolutionController resolution;
+    resolution.targetMilliseconds = frameBudgetMilliseconds;
+    resolution.minScale = std::min(resolution.minScale, resolutionScale);
+    resolution.scale = resolutionScale;
+    UpscalePass upscalePass;
+
+    //Benchmark runs start with every texture resident so all runs draw the same thing
+    if (benchmarking)
+    {
+        while (textureLoader.pending() > 0)
+            textureLoader.update();
+    }
+    BenchmarkRecorder benchmark;
+    GpuFrameTimer gpuTimer;
+    GpuSampleCounter sampleCounter;
+    double shadedSamples = 0.0;
+    unsigned int frameIndex = 0;
+
+    //CPU and GPU time for each pass of the render loop, shown in the corner and dumped as a Chrome trace on request
+    Profiler profiler;
+    profiler.init();
+    TextOverlay profilerOverlay;
+    if (headless)
+        showProfilerOverlay = false;
+    //Depth pyramid for occlusion culling, built after the opaque draws and read back a few frames later
+    HiZBuffer hiZ;
+    std::shared_ptr<const DepthPyramid> depthPyramid;
+    double occludedTotal = 0.0;
+
+    RenderQueue renderQueue;
+    //Submitted ahead of renderQueue whatever the sort keys say
+    RenderQueue depthQueue;
+    RenderStateStats reportStateStats;
+
+    //Two packets, one being submitted while the other is updated. nextPacketReady is valid while an update is in flight
+    FramePacket framePackets[2];
+    unsigned int packetIndex = 0;
+    std::future<void> nextPacketReady;
+    CullingStats cullingStats;
+    std::vector<unsigned int> lodCounts;
+
+    //Simulation clock and pacing, see SIMULATION_STEP and --fps
+    FixedTimestep timestep(SIMULATION_STEP);
+    glm::vec3 previousCameraPosition = camera.Position;
+    FrameLimiter frameLimiter;
+    frameLimiter.targetFps = targetFps;
+    LatencyTimer latencyTimer;
+    double latencyMilliseconds = 0.0;
+
+    //Frame time reporting, printed once a second so the two draw paths can be compared
+    double reportStart = glfwGetTime();
+    unsigned int reportFrames = 0;
+
+    //Setup above bound things directly, start the loop with nothing assumed. Textures and programs are bound per draw by the render queue
+    renderState.invalidate();
 
     //Render loop
     while (!glfwWindowShouldClose(window))
     {
-        float time = glfwGetTime();
-        //Light Position, set to move in a circle
-        glm::vec3 lightPos(0.0f, 2.5f, -4.0f);
-        float lightOffsetX = sin(time)*2;
-        float lightOffsetY = cos(time)*2;
-        lightPos = glm::vec3 (lightPos.x+lightOffsetX, lightPos.y + lightOffsetY, lightPos.z);
-
-        float currentFrame = time;
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-        //Input call
-        processInput(window);
-
-        //Rendering commands
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        //Clear color and depth buffers, or info piles up
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        ourShader.use();
-        glBindVertexArray(VAO);
-        //Position setting for cubes
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        ourShader.setMat4("projection", projection);
-
-        glm::mat4 view = camera.GetViewMatrix();
-        ourShader.setMat4("view", view);
-
-        ourShader.setFloat("mixValue", mixValue); 
-        ourShader.setVec3("lightPos", lightPos);
-        ourShader.setVec3("viewPos", camera.Position);
-
-        //Drawing loop for the cubes
-        for (unsigned int i = 0; i < 10; i++)
-        {
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::translate(model, cubePositions[i]);
-            //Spin even indexed cubes over time, offset all cube spins
-            if ((i+2)%2==0)
+        double frameStart = glfwGetTime();
+        frameStats = FrameStats();
+        profiler.beginFrame();
+        //Wall clock time since the last frame, fed to the simulation clock
+        deltaTime = benchmarking ? 1.0f / 60.0f : (float)frameStart - lastFrame;
+        lastFrame = (float)frameStart;
+        float time;
+        //What the frame is drawn from, keyboard movement interpolated between the last two simulation steps
+        Camera renderCamera = camera;
+        GLint64 inputTimestamp;
+        {
+            ProfileScope scope(profiler, "input");
+            inputTimestamp = LatencyTimer::now();
+            //Benchmark frames advance a fixed 1/60 s along a scripted camera path so every run animates identically
+            if (benchmarking)
             {
-                model = glm::rotate(model, glm::radians((time * 10.0f) + (i * 20.0f)), glm::vec3(1.0f, 1.0f, 0.0f));
+                scriptedCamera(frameIndex, BENCHMARK_WARMUP_FRAMES + benchmarkFrames);
+                time = frameIndex / 60.0f;
             }
             else
             {
-                model = glm::rotate(model, glm::radians(i * 20.0f), glm::vec3(1.0f, 1.0f, 0.0f));
+                bool overlayWasShown = showProfilerOverlay;
+                processInput(window);
+                //The text is otherwise only set with the report, don't leave a freshly shown overlay blank until then
+                if (showProfilerOverlay && !overlayWasShown)
+                    profilerOverlay.setText(renderState, profiler.overlayText());
+                unsigned int steps = timestep.advance(deltaTime);
+                for (unsigned int i = 0; i < steps; i++)
+                {
+                    previousCameraPosition = camera.Position;
+                    simulateStep(window, (float)timestep.step);
+                }
+                time = (float)timestep.interpolatedTime();
             }
-            
-            ourShader.setMat4("model", model);
+            renderCamera = camera;
+            if (!benchmarking)
+                renderCamera.Position = glm::mix(previousCameraPosition, camera.Position, (float)timestep.alpha());
+        }
+        {
+            ProfileScope scope(profiler, "texture upload");
+            //Upload any textures that finished decoding, and the first material if the mix keys moved it
+            textureLoader.update();
+            materialTable.set(0, firstMaterial(containerLayer, faceLayer));
+            materialTable.upload();
+        }
+
+        //Follow the output size, a minimised window has none so the old targets are kept until it's back
+        int outputWidth = headless ? offscreenTarget.width : framebufferWidth;
+        int outputHeight = headless ? offscreenTarget.height : framebufferHeight;
+        if (outputWidth > 0 && outputHeight > 0 && (outputWidth != sceneTarget.width || outputHeight != sceneTarget.height))
+        {
+            sceneTarget.create(outputWidth, outputHeight);
+            //Creating the attachments binds a texture directly
+            renderState.invalidate();
+            resolution.reset();
+        }
+        if (!dynamicResolution)
+        {
+            resolution.scale = resolutionScale;
+            resolution.reset();
+        }
+        int renderWidth = resolution.scaled(sceneTarget.width);
+        int renderHeight = resolution.scaled(sceneTarget.height);
 
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+        if (useOcclusionCulling)
+            depthPyramid = hiZ.collect(renderState);
+        else if (depthPyramid)
+        {
+            hiZ.reset();
+            depthPyramid.reset();
         }
 
-        lightShader.use();
-        glBindVertexArray(lightVAO);
-        glm::mat4 lightModel = glm::mat4(1.0f);
-        lightModel = glm::translate(lightModel, lightPos);
-        lightModel = glm::scale(lightModel, glm::vec3(0.2f));
-        lightShader.setMat4("model", lightModel);
-        glm::mat4 lightView = camera.GetViewMatrix();
-        lightShader.setMat4("view", lightView);
-        glm::mat4 lightProjection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        lightShader.setMat4("projection", lightProjection);
+        //This frame's packet was either started last frame, or gets built now with the GL thread helping
+        FramePacket& packet = framePackets[packetIndex];
+        if (nextPacketReady.valid())
+        {
+            ProfileScope scope(profiler, "update wait");
+            nextPacketReady.get();
+        }
+        else
+        {
+            ProfileScope scope(profiler, "scene update");
+            packet.camera = renderCamera;
+            packet.time = time;
+            packet.inputTimestamp = inputTimestamp;
+            packet.frustumCulling = useFrustumCulling;
+            packet.sortFrontToBack = depthMode == DEPTH_FRONT_TO_BACK;
+            packet.lightCount = lightCount;
+            packet.aspectRatio = (float)sceneTarget.width / (float)sceneTarget.height;
+            packet.renderHeight = (float)renderHeight;
+            packet.depthPyramid = depthPyramid;
+            packet.lodSelector.levels = (unsigned int)cubeMesh.lods.size();
+            packet.lodSelection = useLod;
+            updateScene(packet, cubePositions, cubeTransforms, cubeGrid, cubeLods, threadPool);
+        }
+        //Kick off next frame's update so it runs while this one is submitted
+        if (pipelinedUpdate)
+        {
+            FramePacket& nextPacket = framePackets[packetIndex ^ 1];
+            nextPacket.camera = renderCamera;
+            nextPacket.inputTimestamp = inputTimestamp;
+            nextPacket.time = benchmarking ? (frameIndex + 1) / 60.0f : time + deltaTime;
+            nextPacket.frustumCulling = useFrustumCulling;
+            nextPacket.sortFrontToBack = depthMode == DEPTH_FRONT_TO_BACK;
+            nextPacket.lightCount = lightCount;
+            nextPacket.aspectRatio = (float)sceneTarget.width / (float)sceneTarget.height;
+            nextPacket.renderHeight = (float)renderHeight;
+            nextPacket.depthPyramid = depthPyramid;
+            nextPacket.lodSelector.levels = (unsigned int)cubeMesh.lods.size();
+            nextPacket.lodSelection = useLod;
+            nextPacketReady = threadPool.submitTask([&nextPacket, &cubePositions, &cubeTransforms, &cubeGrid, &cubeLods, &threadPool]() {
+                updateScene(nextPacket, cubePositions, cubeTransforms, cubeGrid, cubeLods, threadPool);
+            });
+        }
+        cullingStats = packet.cullingStats;
+        lodCounts = packet.lodCounts;
+        unsigned int visibleCount = (unsigned int)packet.visibleCubes.size();
+
+        sceneTarget.bind(renderWidth, renderHeight);
+        gpuTimer.begin(frameIndex);
+
+        {
+            ProfileScope scope(profiler, "frame setup");
+            //Enable depth testing
+            renderState.setEnabled(GL_DEPTH_TEST, true);
+            renderState.setEnabled(GL_BLEND, false);
+            //Rendering commands
+            glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+            //Clear color and depth buffers, or info piles up. Depth writes may have been left off by the last shading pass
+            renderState.depthMask(true);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            //Only waits if the GPU is still reading the region from StreamBuffer::REGIONS frames ago
+            streamBuffer.beginFrame();
+            lightGridBuffer.stream.beginFrame();
+            //Camera and light data computed by the update, shared by every shader through the uniform block.
+            //The light grid's texel offsets are only known once it's in this frame's region
+            FrameUniforms uniforms = packet.uniforms;
+            unsigned int lightGridBase = 0;
+            if (lightGridBuffer.upload(packet.lightGrid, lightGridBase))
+                uniforms.lightOffsets = glm::vec4((float)(lightGridBase + packet.lightGrid.lightsTexel), (float)(lightGridBase + packet.lightGrid.clustersTexel),
+                    (float)(lightGridBase + packet.lightGrid.indicesTexel), 0.0f);
+            uploadFrameUniforms(streamBuffer, uniforms);
+        }
+
+        //Instanced path writes every visible cube's matrices into this frame's region once, read by the pre-pass and the shading pass.
+        //The indirect path draws a pooled model in the same batch, its matrices go after the cubes'
+        bool indirect = useIndirect && useInstancing && IndirectDrawList::available();
+        bool modelInBatch = indirect && pooledModel >= 0;
+        unsigned int batchInstances = visibleCount + (modelInBatch ? 1 : 0);
+        StreamAllocation cubeInstances;
+        StreamAllocation indirectCommands;
+        if (useInstancing && batchInstances > 0)
+        {
+            ProfileScope scope(profiler, "cube upload");
+            cubeInstances = streamBuffer.allocate(batchInstances * sizeof(InstanceTransform));
+            if (cubeInstances.data)
+            {
+                std::memcpy(cubeInstances.data, packet.instances.data(), visibleCount * sizeof(InstanceTransform));
+                if (modelInBatch)
+                {
+                    InstanceTransform* model = static_cast<InstanceTransform*>(cubeInstances.data) + visibleCount;
+                    model->model = importedModelMatrix;
+                    model->normalMatrix = importedNormalMatrix;
+                    model->material = MODEL_MATERIAL;
+                }
+                streamBuffer.commit(cubeInstances);
+            }
+            //One command per cube LOD, each starting at its run of matrices, then the model's
+            if (indirect && cubeInstances.data)
+            {
+                indirectDraws.clear();
+                unsigned int first = 0;
+                for (unsigned int lod = 0; lod < packet.lodCounts.size(); lod++)
+                {
+                    indirectDraws.add(cubeMesh.lods[lod], meshPool.indexType, packet.lodCounts[lod], first);
+                    first += packet.lodCounts[lod];
+                }
+                if (modelInBatch)
+                {
+                    for (const MeshLod& lod : meshPool.meshes[pooledModel].lods)
+                        indirectDraws.add(lod, meshPool.indexType, 1, visibleCount);
+                }
+                indirectCommands = streamBuffer.allocate(indirectDraws.bytes(), sizeof(GLuint));
+                if (indirectCommands.data)
+                {
+                    std::memcpy(indirectCommands.data, indirectDraws.commands.data(), indirectCommands.size);
+                    streamBuffer.commit(indirectCommands);
+                }
+            }
+        }
+        bool depthPrepass = depthMode == DEPTH_PREPASS;
+
+        //Depth-only pass over the cubes, color writes off, so the shading pass below only shades the front-most fragment
+        if (depthPrepass)
+        {
+            DrawItem depthCubes;
+            depthCubes.program = depthShader.shaderProgram;
+            depthCubes.vertexArray = depthVAO;
+            depthCubes.draw = [&]() {
+                ProfileScope scope(profiler, "depth prepass");
+                renderState.colorMask(false);
+                renderState.depthFunc(GL_LESS);
+                renderState.depthMask(true);
+                unsigned int first = 0;
+                if (indirectCommands.data)
+                {
+                    depthShader.setBool(depthInstancedUniform, true);
+                    setInstanceAttributes(renderState, depthVAO, streamBuffer.buffer, cubeInstances.offset, sizeof(InstanceTransform), false);
+                    renderState.bindBuffer(GL_DRAW_INDIRECT_BUFFER, streamBuffer.buffer);
+                    frameStats.drawCalls += indirectDraws.draw(meshPool.indexType, indirectCommands.offset);
+                    frameStats.triangles += indirectDraws.triangles();
+                }
+                else if (cubeInstances.data)
+                {
+                    depthShader.setBool(depthInstancedUniform, true);
+                    for (unsigned int lod = 0; lod < packet.lodCounts.size(); lod++)
+                    {
+                        GLsizei count = (GLsizei)packet.lodCounts[lod];
+                        const MeshLod& mesh = cubeMesh.lods[lod];
+                        if (count == 0)
+                            continue;
+                        setInstanceAttributes(renderState, depthVAO, streamBuffer.buffer, cubeInstances.offset + first * sizeof(InstanceTransform), sizeof(InstanceTransform), false);
+                        glDrawElementsInstanced(GL_TRIANGLES, mesh.indexCount, cubeMesh.indexType, (void*)mesh.indexOffset, count);
+                        frameStats.drawCalls++;
+                        frameStats.triangles += (unsigned long long)mesh.indexCount / 3 * count;
+                        first += count;
+                    }
+                }
+                else if (!useInstancing)
+                {
+                    depthShader.setBool(depthInstancedUniform, false);
+                    for (unsigned int lod = 0; lod < packet.lodCounts.size(); lod++)
+                    {
+                        const MeshLod& mesh = cubeMesh.lods[lod];
+                        for (unsigned int i = first; i < first + packet.lodCounts[lod]; i++)
+                        {
+                            depthShader.setMat4(depthModelUniform, packet.instances[i].model);
+                            glDrawElements(GL_TRIANGLES, mesh.indexCount, cubeMesh.indexType, (void*)mesh.indexOffset);
+                            frameStats.drawCalls++;
+                            frameStats.triangles += mesh.indexCount / 3;
+                        }
+                        first += packet.lodCounts[lod];
+                    }
+                }
+                renderState.colorMask(true);
+            };
+            depthQueue.add(depthCubes);
+            depthQueue.submit(renderState);
+        }
+
+        //Queue both passes and let the sort key order them, items sharing a program, textures or VAO end up together
+        {
+            //Cheapest variant for what the cubes use this frame, its uniform handles are looked up once per frame
+            Shader* cubeShader = &cubeShaders.get(cubeShaderFeatures(materialTable));
+            UniformHandle modelUniform = cubeShader->uniform("model");
+            UniformHandle normalMatrixUniform = cubeShader->uniform("normalMatrix");
+            UniformHandle instancedUniform = cubeShader->uniform("instanced");
+            UniformHandle materialUniform = cubeShader->uniform("material");
+            DrawItem cubes;
+            cubes.program = cubeShader->shaderProgram;
+            cubes.vertexArray = cubeMesh.VAO;
+            cubes.key = drawSortKey(cubes.program, NO_TEXTURE_SET, cubes.vertexArray, 0.0f);
+            cubes.draw = [&, cubeShader, modelUniform, normalMatrixUniform, instancedUniform, materialUniform]() {
+                ProfileScope scope(profiler, "cube draw");
+                //After a pre-pass only fragments matching the stored depth pass, and depth is already final
+                renderState.depthFunc(depthPrepass ? GL_EQUAL : GL_LESS);
+                renderState.depthMask(!depthPrepass);
+                sampleCounter.begin(frameIndex);
+                unsigned int first = 0;
+                if (indirectCommands.data)
+                {
+                    //Everything pooled at once, each command finds its matrices through its base instance
+                    cubeShader->setBool(instancedUniform, true);
+                    setInstanceAttributes(renderState, cubeMesh.VAO, streamBuffer.buffer, cubeInstances.offset, sizeof(InstanceTransform), true);
+                    renderState.bindBuffer(GL_DRAW_INDIRECT_BUFFER, streamBuffer.buffer);
+                    frameStats.drawCalls += indirectDraws.draw(meshPool.indexType, indirectCommands.offset);
+                    frameStats.triangles += indirectDraws.triangles();
+                }
+                else if (cubeInstances.data)
+                {
+                    //One call per LOD from the matrices uploaded above, each reading its own run of them
+                    cubeShader->setBool(instancedUniform, true);
+                    for (unsigned int lod = 0; lod < packet.lodCounts.size(); lod++)
+                    {
+                        GLsizei count = (GLsizei)packet.lodCounts[lod];
+                        const MeshLod& mesh = cubeMesh.lods[lod];
+                        if (count == 0)
+                            continue;
+                        setInstanceAttributes(renderState, cubeMesh.VAO, streamBuffer.buffer, cubeInstances.offset + first * sizeof(InstanceTransform), sizeof(InstanceTransform), true);
+                        glDrawElementsInstanced(GL_TRIANGLES, mesh.indexCount, cubeMesh.indexType, (void*)mesh.indexOffset, count);
+                        frameStats.drawCalls++;
+                        frameStats.triangles += (unsigned long long)mesh.indexCount / 3 * count;
+                        first += count;
+                    }
+                }
+                else if (!useInstancing)
+                {
+                    //Drawing loop for the cubes, kept on plain uniforms as the one-draw-per-cube baseline
+                    cubeShader->setBool(instancedUniform, false);
+                    for (unsigned int lod = 0; lod < packet.lodCounts.size(); lod++)
+                    {
+                        const MeshLod& mesh = cubeMesh.lods[lod];
+                        for (unsigned int i = first; i < first + packet.lodCounts[lod]; i++)
+                        {
+                            cubeShader->setMat4(modelUniform, packet.instances[i].model);
+                            cubeShader->setMat3(normalMatrixUniform, packet.instances[i].normalMatrix);
+                            cubeShader->setInt(materialUniform, (int)packet.instances[i].material);
+
+                            glDrawElements(GL_TRIANGLES, mesh.indexCount, cubeMesh.indexType, (void*)mesh.indexOffset);
+                            frameStats.drawCalls++;
+                            frameStats.triangles += mesh.indexCount / 3;
+                        }
+                        first += packet.lodCounts[lod];
+                    }
+                }
+                sampleCounter.end();
+            };
+            renderQueue.add(cubes);
+
+            //Model meshes outside the indirect batch, each its own item. Not in the pre-pass or the culling
+            size_t separateModelMeshes = modelInBatch ? modelMeshes.size() - 1 : modelMeshes.size();
+            for (size_t i = 0; i < separateModelMeshes; i++)
+            {
+                const Mesh& mesh = modelMeshes[i];
+                DrawItem item;
+                item.program = cubeShader->shaderProgram;
+                item.vertexArray = mesh.VAO;
+                item.key = drawSortKey(item.program, NO_TEXTURE_SET, item.vertexArray, 0.0f);
+                item.draw = [&, cubeShader, modelUniform, normalMatrixUniform, instancedUniform, materialUniform]() {
+                    ProfileScope scope(profiler, "model draw");
+                    renderState.depthFunc(GL_LESS);
+                    renderState.depthMask(true);
+                    cubeShader->setInt(materialUniform, (int)MODEL_MATERIAL);
+                    cubeShader->setBool(instancedUniform, false);
+                    cubeShader->setMat4(modelUniform, importedModelMatrix);
+                    cubeShader->setMat3(normalMatrixUniform, importedNormalMatrix);
+                    for (const MeshLod& lod : mesh.lods)
+                    {
+                        glDrawElements(GL_TRIANGLES, lod.indexCount, mesh.indexType, (void*)lod.indexOffset);
+                        frameStats.drawCalls++;
+                        frameStats.triangles += lod.indexCount / 3;
+                    }
+                };
+                renderQueue.add(item);
+            }
+
+            DrawItem light;
+            light.program = lightShader.shaderProgram;
+            light.vertexArray = lightVAO;
+            //View distance of the main light over the far plane, from the translation column of its model matrix
+            glm::vec4 lightClip = packet.uniforms.viewProjection * packet.lightInstances[0].model[3];
+            light.key = drawSortKey(light.program, NO_TEXTURE_SET, light.vertexArray, lightClip.w / FAR_PLANE);
+            light.draw = [&]() {
+                ProfileScope scope(profiler, "light cube");
+                //Light cubes aren't in the pre-pass
+                renderState.depthFunc(GL_LESS);
+                renderState.depthMask(true);
+                GLsizei lightCubes = (GLsizei)packet.lightInstances.size();
+                StreamAllocation lightInstances = streamBuffer.allocate(lightCubes * sizeof(LightInstance));
+                if (lightInstances.data)
+                {
+                    std::memcpy(lightInstances.data, packet.lightInstances.data(), lightInstances.size);
+                    streamBuffer.commit(lightInstances);
+                    setLightInstanceAttributes(renderState, lightVAO, streamBuffer.buffer, lightInstances.offset);
+
+                    glDrawElementsInstanced(GL_TRIANGLES, lightLod.indexCount, cubeMesh.indexType, (void*)lightLod.indexOffset, lightCubes);
+                    frameStats.drawCalls++;
+                    frameStats.triangles += (unsigned long long)lightLod.indexCount / 3 * lightCubes;
+                }
+            };
+            renderQueue.add(light);
+        }
+        renderQueue.submit(renderState);
+        //Every draw reading this frame's region has been issued
+        streamBuffer.endFrame();
+        lightGridBuffer.stream.endFrame();
+
+        //Depth is final once the opaque draws are in, reduce it for the culling a few frames from now
+        if (useOcclusionCulling)
+        {
+            ProfileScope scope(profiler, "hi-z build");
+            hiZ.build(renderState, sceneTarget.framebuffer, sceneTarget.width, sceneTarget.height, renderWidth, renderHeight, packet.uniforms.view, packet.uniforms.projection);
+        }
+
+        {
+            ProfileScope scope(profiler, "upscale");
+            upscalePass.draw(renderState, sceneTarget, renderWidth, renderHeight, headless ? offscreenTarget.framebuffer : 0, outputWidth, outputHeight);
+        }
+
+        if (showProfilerOverlay)
+        {
+            ProfileScope scope(profiler, "overlay");
+            profilerOverlay.draw(renderState);
+        }
 
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        gpuTimer.end();
+        double cpuMilliseconds = (glfwGetTime() - frameStart) * 1000.0;
+        double gpuMilliseconds;
+        bool gpuTimeReady = gpuTimer.collect(frameIndex, gpuMilliseconds);
+        if (gpuTimeReady && dynamicResolution)
+            resolution.update(gpuMilliseconds);
+        bool samplesReady = sampleCounter.collect(frameIndex, shadedSamples);
+        if (benchmarking)
+        {
+            //GPU results lag a few frames behind, so they're recorded for whichever frame just became available
+            if (frameIndex >= BENCHMARK_WARMUP_FRAMES)
+            {
+                benchmark.addFrame(cpuMilliseconds, frameStats);
+                occludedTotal += cullingStats.occluded;
+            }
+            if (gpuTimeReady && frameIndex >= BENCHMARK_WARMUP_FRAMES + GpuFrameTimer::LATENCY - 1)
+                benchmark.addGpuTime(gpuMilliseconds);
+            if (samplesReady && frameIndex >= BENCHMARK_WARMUP_FRAMES + GpuSampleCounter::LATENCY - 1)
+                benchmark.addShadedSamples(shadedSamples);
+        }
+        frameIndex++;
+        if (benchmarking && frameIndex >= BENCHMARK_WARMUP_FRAMES + benchmarkFrames)
+            break;
 
-        //Swap buffers and poll IO events (keys press, mouse moved, etc)
-        glfwSwapBuffers(window);
+        {
+            ProfileScope scope(profiler, "swap");
+            //Swap buffers
+            if (headless)
+                glFlush();
+            else
+                glfwSwapBuffers(window);
+            latencyTimer.end(frameIndex, packet.inputTimestamp);
+        }
+        bool latencyReady = latencyTimer.collect(frameIndex, latencyMilliseconds);
+        if (benchmarking && latencyReady && frameIndex >= BENCHMARK_WARMUP_FRAMES + LatencyTimer::LATENCY)
+            benchmark.addLatency(latencyMilliseconds);
+        {
+            ProfileScope scope(profiler, "frame limiter");
+            frameLimiter.wait();
+        }
+        //Poll IO events (keys press, mouse moved, etc) after the wait, so the next frame starts from the freshest input
         glfwPollEvents();
+        profiler.endFrame();
+        packetIndex ^= 1;
+
+        reportFrames++;
+        double reportTime = glfwGetTime() - reportStart;
+        if (reportTime >= 1.0 && !benchmarking)
+        {
+            std::cout << (!useInstancing ? "Per-draw" : indirect ? (IndirectDrawList::multiDraw() ? "Multi-draw indirect" : "Base instance") : "Instanced") << ": " << (reportTime * 1000.0 / reportFrames) << " ms/frame ("
+                << frameLimiter.waitMilliseconds / reportFrames << " ms limiter wait), " << latencyMilliseconds << " ms input latency, " << cullingStats.visible << " visible, "
+                << cullingStats.culled << " culled (" << (useFrustumCulling ? "culling on" : "culling off") << "), "
+                << cullingStats.occluded << " occluded (" << (useOcclusionCulling ? "occlusion on" : "occlusion off") << "), "
+                << streamBuffer.stats.stalls << " stream stalls, " << lightCount << " lights, "
+                << renderWidth << "x" << renderHeight << (dynamicResolution ? " dynamic" : "") << " render size, ";
+            std::cout << "LODs";
+            for (unsigned int count : lodCounts)
+                std::cout << " " << count;
+            std::cout << (useLod ? "" : " (LOD off)") << ", "
+                << DEPTH_MODE_NAMES[depthMode] << " " << (unsigned long long)shadedSamples << " shaded samples, "
+                << (renderState.stats.skipped - reportStateStats.skipped) / reportFrames << " of "
+                << (renderState.stats.calls - reportStateStats.calls) / reportFrames << " state calls skipped/frame" << std::endl;
+            reportStateStats = renderState.stats;
+            frameLimiter.waitMilliseconds = 0.0;
+            if (watchShaders)
+            {
+                //Variants are set up again by cubeShaders itself
+                bool cubeShadersReloaded = cubeShaders.reloadIfChanged();
+                bool lightShaderReloaded = lightShader.reloadIfChanged();
+                if (lightShaderReloaded)
+                    lightShader.bindUniformBlock("FrameData", FRAME_UNIFORMS_BINDING);
+                bool depthShaderReloaded = depthShader.reloadIfChanged();
+                if (depthShaderReloaded)
+                {
+                    depthShader.bindUniformBlock("FrameData", FRAME_UNIFORMS_BINDING);
+                    depthModelUniform = depthShader.uniform("model");
+                    depthInstancedUniform = depthShader.uniform("instanced");
+                }
+                //The old program ids are gone, don't let the cache skip a bind to a reused id
+                if (cubeShadersReloaded || lightShaderReloaded || depthShaderReloaded)
+                    renderState.invalidate();
+            }
+            //Overlay text only changes with the report, so its quads aren't rebuilt every frame
+            if (showProfilerOverlay)
+                profilerOverlay.setText(renderState, profiler.overlayText());
+            reportStart = glfwGetTime();
+            reportFrames = 0;
+        }
+        if (writeTraceNow)
+        {
+            profiler.writeChromeTrace(traceOutput);
+            writeTraceNow = false;
+        }
+    }
+
+    //The in-flight update writes into a packet, let it finish before anything goes away
+    if (nextPacketReady.valid())
+        nextPacketReady.get();
+    if (benchmarking || traceRequested)
+    {
+        //Make sure the last frames' timer queries are done before reporting
+        glFinish();
+        profiler.flush();
+    }
+    if (traceRequested)
+        profiler.writeChromeTrace(traceOutput);
+    if (benchmarking)
+    {
+        //Triangles per cube at each LOD, finest first. With LOD off every cube draws the last one
+        std::ostringstream lodTriangles;
+        lodTriangles << "[";
+        for (size_t lod = 0; lod < cubeMesh.lods.size(); lod++)
+            lodTriangles << (lod > 0 ? ", " : "") << cubeMesh.lods[lod].indexCount / 3;
+        lodTriangles << "]";
+        std::ostringstream settings;
+        settings << "{ \"cubes\": " << cubePositions.size()
+            << ", \"width\": " << SCR_WIDTH << ", \"height\": " << SCR_HEIGHT
+            << ", \"dynamic_resolution\": " << (dynamicResolution ? "true" : "false")
+            << ", \"frame_budget_ms\": " << frameBudgetMilliseconds
+            << ", \"resolution_scale\": " << resolution.scale
+            << ", \"instancing\": " << (useInstancing ? "true" : "false")
+            << ", \"indirect\": \"" << (!useIndirect || !IndirectDrawList::available() ? "off" : IndirectDrawList::multiDraw() ? "multi_draw" : "base_instance") << "\""
+            << ", \"frustum_culling\": " << (useFrustumCulling ? "true" : "false")
+            << ", \"occlusion_culling\": " << (useOcclusionCulling ? "true" : "false")
+            << ", \"occluded_per_frame\": " << occludedTotal / benchmarkFrames
+            << ", \"lod\": " << (useLod ? "true" : "false")
+            << ", \"lod_levels\": " << cubeMesh.lods.size()
+            << ", \"lod_triangles\": " << lodTriangles.str()
+            << ", \"swap_interval\": " << (headless ? 0 : swapInterval)
+            << ", \"target_fps\": " << targetFps
+            << ", \"pipelined_update\": " << (pipelinedUpdate ? "true" : "false")
+            << ", \"stream_buffer\": \"" << (streamBuffer.persistent ? "persistent" : "unsynchronized") << "\""
+            << ", \"stream_stalls\": " << streamBuffer.stats.stalls
+            << ", \"stream_stall_ms\": " << streamBuffer.stats.stallMilliseconds
+            << ", \"stream_overflows\": " << streamBuffer.stats.overflows
+            << ", \"state_calls_per_frame\": " << renderState.stats.calls / (double)frameIndex
+            << ", \"state_calls_skipped_per_frame\": " << renderState.stats.skipped / (double)frameIndex
+            << ", \"shader_build_ms\": " << shaderBuildMilliseconds
+            << ", \"shader_variants\": " << cubeShaders.size()
+            << ", \"compressed_textures\": " << (compressedTextures ? "true" : "false")
+            << ", \"lights\": " << lightCount
+            << ", \"depth_mode\": \"" << DEPTH_MODE_NAMES[depthMode] << "\""
+            << ", \"renderer\": \"" << glGetString(GL_RENDERER) << "\" }";
+        std::cout << benchmark.toJson(settings.str());
+        benchmark.writeJson(benchmarkOutput, settings.str());
     }
 
     //De-allocate resources since rendering has been stopped
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
+    offscreenTarget.destroy();
+    sceneTarget.destroy();
+    upscalePass.destroy();
+    profilerOverlay.destroy();
+    hiZ.destroy();
+    importedModel.destroy();
+    std::vector<unsigned int> profilerQueries = profiler.allQueries();
+    if (!profilerQueries.empty())
+        glDeleteQueries((GLsizei)profilerQueries.size(), profilerQueries.data());
+    glDeleteQueries(GpuFrameTimer::LATENCY, gpuTimer.queries);
+    glDeleteQueries(GpuSampleCounter::LATENCY, sampleCounter.queries);
+    glDeleteQueries(LatencyTimer::LATENCY, latencyTimer.queries);
+    meshPool.destroy();
+    glDeleteVertexArrays(1, &lightVAO);
+    glDeleteVertexArrays(1, &depthVAO);
+    streamBuffer.destroy();
+    lightGridBuffer.destroy();
+    textureLoader.destroy();
+    textureArray.destroy();
+    materialTable.destroy();
+    cubeShaders.destroy();
+    glDeleteProgram(lightShader.shaderProgram);
+    glDeleteProgram(depthShader.shaderProgram);
 
     //Clear all allocated resources to glfw
     glfwTerminate();
     return 0;
 }
 
-//Process all inputs
+//Once per frame input: quitting and toggles. Held keys are handled by simulateStep
 void processInput(GLFWwindow* window)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
+    //Draw path and culling toggles
+    if (keyPressedOnce(window, GLFW_KEY_I, instancingKeyDown))
+        useInstancing = !useInstancing;
+    if (keyPressedOnce(window, GLFW_KEY_M, indirectKeyDown))
+        useIndirect = !useIndirect;
+    if (keyPressedOnce(window, GLFW_KEY_C, cullingKeyDown))
+        useFrustumCulling = !useFrustumCulling;
+    if (keyPressedOnce(window, GLFW_KEY_O, occlusionKeyDown))
+        useOcclusionCulling = !useOcclusionCulling;
+    if (keyPressedOnce(window, GLFW_KEY_K, lodKeyDown))
+        useLod = !useLod;
+    if (keyPressedOnce(window, GLFW_KEY_U, pipelineKeyDown))
+        pipelinedUpdate = !pipelinedUpdate;
+    //Profiler overlay toggle and trace dump
+    if (keyPressedOnce(window, GLFW_KEY_P, overlayKeyDown))
+        showProfilerOverlay = !showProfilerOverlay;
+    if (keyPressedOnce(window, GLFW_KEY_T, traceKeyDown))
+        writeTraceNow = true;
+    if (keyPressedOnce(window, GLFW_KEY_V, vertexColorKeyDown))
+        useVertexColors = !useVertexColors;
+    if (keyPressedOnce(window, GLFW_KEY_L, lightsKeyDown))
+        lightCount = lightCount > 1 ? 1 : manyLightCount;
+    if (keyPressedOnce(window, GLFW_KEY_Z, depthModeKeyDown))
+        depthMode = (depthMode + 1) % (DEPTH_PREPASS + 1);
+    //Shader hot reload toggle
+    if (keyPressedOnce(window, GLFW_KEY_H, watchShadersKeyDown))
+        watchShaders = !watchShaders;
+    if (keyPressedOnce(window, GLFW_KEY_R, dynamicResolutionKeyDown))
+        dynamicResolution = !dynamicResolution;
+}
+
+//Held keys, run once per fixed simulation step so their speed doesn't depend on the frame rate
+void simulateStep(GLFWwindow* window, float step)
+{
     //Texture mixing controls
     if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
-    {    
-        mixValue += 0.005f;
+    {
+        mixValue += 0.3f * step;
         if (mixValue >= 1.0f)
            mixValue = 1.0f;
     }
     if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
     {
-        mixValue -= 0.005f;
+        mixValue -= 0.3f * step;
         if (mixValue <= 0.0f)
             mixValue = 0.0f;
     }
     //Camera keyboard controls, defined through camera class enum to be device independent 
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
     {
-        camera.ProcessKeyboard(FORWARD, deltaTime);
+        camera.ProcessKeyboard(FORWARD, step);
     }
     if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
     {
-        camera.ProcessKeyboard(BACKWARD, deltaTime);
+        camera.ProcessKeyboard(BACKWARD, step);
     }
     if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
     {
-        camera.ProcessKeyboard(LEFT, deltaTime);
+        camera.ProcessKeyboard(LEFT, step);
     }
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
     {
-        camera.ProcessKeyboard(RIGHT, deltaTime);
+        camera.ProcessKeyboard(RIGHT, step);
+    }
+}
+
+//Benchmark camera path: flies from the start position deep into the cube field while sweeping left and right
+void scriptedCamera(unsigned int frame, unsigned int frameCount)
+{
+    float t = frameCount > 1 ? frame / (float)(frameCount - 1) : 0.0f;
+    camera.Position = glm::vec3(8.0f * sin(t * 6.2831853f), 2.0f * sin(t * 12.566371f), 3.0f - 80.0f * t);
+    camera.SetOrientation(-90.0f + 30.0f * sin(t * 6.2831853f), 10.0f * cos(t * 6.2831853f));
+}
+
+//Cull the cube field and build the frame's uniforms and matrices. Runs as a job when pipelined, the work inside is split over the pool either way
+void updateScene(FramePacket& packet, const std::vector<glm::vec3>& cubePositions, const TransformBatch& cubeTransforms, SceneGrid& cubeGrid, std::vector<unsigned char>& cubeLods, ThreadPool& threadPool)
+{
+    //Light Position, set to move in a circle
+    glm::vec3 lightPos(0.0f, 2.5f, -4.0f);
+    float lightOffsetX = sin(packet.time)*2;
+    float lightOffsetY = cos(packet.time)*2;
+    lightPos = glm::vec3 (lightPos.x+lightOffsetX, lightPos.y + lightOffsetY, lightPos.z);
+    //The main light reaches the whole view, the rest are spread through the cube field on small orbits of their own
+    packet.lights.resize(packet.lightCount);
+    packet.lights[0].position = lightPos;
+    packet.lights[0].radius = FAR_PLANE;
+    packet.lights[0].color = lightColor;
+    for (unsigned int i = 1; i < packet.lightCount; i++)
+    {
+        //Golden angle spiral across x/y, evenly spread over the field's depth
+        float angle = i * 2.3999632f;
+        float ring = 38.0f * sqrt(i / (float)packet.lightCount);
+        float depth = fmod(i * 0.618034f, 1.0f);
+        float phase = packet.time * (0.5f + 0.5f * fmod(i * 0.381966f, 1.0f)) + i;
+        PointLight& light = packet.lights[i];
+        light.position = glm::vec3(ring * cos(angle) + 2.0f * sin(phase), ring * sin(angle) + 2.0f * cos(phase), -20.0f - 70.0f * depth);
+        light.radius = 8.0f;
+        float hue = i * 0.618034f * 6.2831853f;
+        light.color = glm::vec3(0.5f + 0.5f * cos(hue), 0.5f + 0.5f * cos(hue - 2.0943951f), 0.5f + 0.5f * cos(hue + 2.0943951f));
+    }
+    packet.lightInstances.resize(packet.lightCount);
+    for (unsigned int i = 0; i < packet.lightCount; i++)
+    {
+        packet.lightInstances[i].model = glm::mat4(1.0f);
+        packet.lightInstances[i].model = glm::translate(packet.lightInstances[i].model, packet.lights[i].position);
+        packet.lightInstances[i].model = glm::scale(packet.lightInstances[i].model, glm::vec3(0.2f));
+        packet.lightInstances[i].color = glm::vec4(packet.lights[i].color, 1.0f);
+    }
+
+    FrameUniforms& uniforms = packet.uniforms;
+    uniforms.view = packet.camera.GetViewMatrix();
+    uniforms.projection = glm::perspective(glm::radians(packet.camera.Zoom), packet.aspectRatio, NEAR_PLANE, FAR_PLANE);
+    uniforms.viewProjection = uniforms.projection * uniforms.view;
+    uniforms.cameraPosition = glm::vec4(packet.camera.Position, 1.0f);
+    uniforms.lightPosition = glm::vec4(lightPos, 1.0f);
+    uniforms.lightColor = glm::vec4(lightColor, 1.0f);
+    uniforms.lightStrengths = glm::vec4(ambientLightStrength, specularLightStrength, 0.0f, 0.0f);
+    uniforms.clusterGrid = glm::vec4((float)LightGrid::CLUSTERS_X, (float)LightGrid::CLUSTERS_Y, (float)LightGrid::CLUSTERS_Z, (float)packet.lightCount);
+    uniforms.clusterDepth = glm::vec4(NEAR_PLANE, LightGrid::depthScale(NEAR_PLANE, FAR_PLANE), 0.0f, 0.0f);
+    packet.lightGrid.build(packet.lights, uniforms.view, uniforms.projection, NEAR_PLANE, FAR_PLANE);
+
+    //Find the cubes inside the view frustum, a few grid cells per job, then stitch the results back together in cell order
+    std::vector<unsigned int>& visible = packet.visibleCubes;
+    visible.clear();
+    packet.cullingStats = CullingStats();
+    if (packet.frustumCulling)
+    {
+        Frustum frustum = Frustum::fromMatrix(uniforms.viewProjection);
+        unsigned int cellCount = cubeGrid.cellCount();
+        unsigned int chunkCount = std::min(cellCount, (threadPool.size() + 1) * 4);
+        packet.chunkVisible.resize(chunkCount);
+        packet.chunkStats.resize(chunkCount);
+        threadPool.parallelFor(chunkCount, 1, [&](unsigned int begin, unsigned int end) {
+            for (unsigned int chunk = begin; chunk < end; chunk++)
+            {
+                packet.chunkVisible[chunk].clear();
+                cubeGrid.cullCells(frustum, chunk * cellCount / chunkCount, (chunk + 1) * cellCount / chunkCount, packet.chunkVisible[chunk], packet.chunkStats[chunk]);
+            }
+        });
+        for (unsigned int chunk = 0; chunk < chunkCount; chunk++)
+        {
+            visible.insert(visible.end(), packet.chunkVisible[chunk].begin(), packet.chunkVisible[chunk].end());
+            const CullingStats& stats = packet.chunkStats[chunk];
+            packet.cullingStats.culled += stats.culled;
+            packet.cullingStats.cellsVisible += stats.cellsVisible;
+            packet.cullingStats.cellsCulled += stats.cellsCulled;
+        }
+    }
+    else
+    {
+        visible.resize(cubePositions.size());
+        for (unsigned int i = 0; i < cubePositions.size(); i++)
+            visible[i] = i;
+    }
+
+    //Drop cubes hidden behind the depth of the frame the pyramid came from, tested in parallel then compacted in order
+    if (packet.depthPyramid)
+    {
+        const DepthPyramid& pyramid = *packet.depthPyramid;
+        std::vector<unsigned char>& occluded = packet.occluded;
+        occluded.resize(visible.size());
+        threadPool.parallelFor((unsigned int)visible.size(), 256, [&](unsigned int begin, unsigned int end) {
+            for (unsigned int i = begin; i < end; i++)
+                occluded[i] = pyramid.occluded(cubePositions[visible[i]], CUBE_BOUNDING_RADIUS) ? 1 : 0;
+        });
+        unsigned int kept = 0;
+        for (unsigned int i = 0; i < visible.size(); i++)
+        {
+            if (!occluded[i])
+                visible[kept++] = visible[i];
+        }
+        packet.cullingStats.occluded = (unsigned int)visible.size() - kept;
+        visible.resize(kept);
+    }
+    packet.cullingStats.visible = (unsigned int)visible.size();
+
+    //Nearest cubes first so the depth test rejects hidden fragments before they're shaded
+    if (packet.sortFrontToBack)
+    {
+        std::vector<std::pair<float, unsigned int>>& order = packet.depthOrder;
+        order.resize(visible.size());
+        glm::vec3 eye = packet.camera.Position;
+        for (unsigned int i = 0; i < visible.size(); i++)
+        {
+            glm::vec3 offset = cubePositions[visible[i]] - eye;
+            order[i] = std::make_pair(glm::dot(offset, offset), visible[i]);
+        }
+        std::sort(order.begin(), order.end());
+        for (unsigned int i = 0; i < visible.size(); i++)
+            visible[i] = order[i].second;
+    }
+
+    //Pick each cube's LOD from its projected size and group the visible list by LOD, keeping the order within each group.
+    //cubeLods is only touched here and updates never overlap, so it's safe to keep across frames
+    const LodSelector& lodSelector = packet.lodSelector;
+    packet.lodCounts.assign(lodSelector.levels, 0);
+    if (packet.lodSelection && lodSelector.levels > 1)
+    {
+        float fieldOfView = glm::radians(packet.camera.Zoom);
+        glm::vec3 eye = packet.camera.Position;
+        for (unsigned int cube : visible)
+        {
+            float pixels = LodSelector::projectedPixels(CUBE_BOUNDING_RADIUS, glm::length(cubePositions[cube] - eye), fieldOfView, packet.renderHeight);
+            cubeLods[cube] = (unsigned char)lodSelector.select(cubeLods[cube], pixels);
+            packet.lodCounts[cubeLods[cube]]++;
+        }
+        std::vector<unsigned int> firsts(lodSelector.levels, 0);
+        for (unsigned int lod = 1; lod < lodSelector.levels; lod++)
+            firsts[lod] = firsts[lod - 1] + packet.lodCounts[lod - 1];
+        packet.lodOrder.resize(visible.size());
+        for (unsigned int cube : visible)
+            packet.lodOrder[firsts[cubeLods[cube]]++] = cube;
+        visible.swap(packet.lodOrder);
+    }
+    else
+    {
+        packet.lodCounts.back() = (unsigned int)visible.size();
+    }
+
+    //Build every visible cube's model and normal matrix up front so both draw paths do the same CPU work. Only the spinning
+    //cubes are computed, the rest come out of the batch's cache
+    packet.instances.resize(cubePositions.size());
+    threadPool.parallelFor((unsigned int)visible.size(), 256, [&](unsigned int begin, unsigned int end) {
+        cubeTransforms.write(packet.time, visible.data() + begin, end - begin, packet.instances.data() + begin);
+    });
+}
+
+//Point the per instance attributes (model at 4-7, normal matrix at 8-10, material at 11) of a VAO at records of stride bytes starting at offset in buffer
+void setInstanceAttributes(RenderState& state, unsigned int VAO, unsigned int buffer, size_t offset, size_t stride, bool normalMatrix)
+{
+    state.bindVertexArray(VAO);
+    state.bindBuffer(GL_ARRAY_BUFFER, buffer);
+    //A mat4 attribute takes up four vec4 locations
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        glVertexAttribPointer(4 + i, 4, GL_FLOAT, GL_FALSE, (GLsizei)stride, (void*)(offset + offsetof(InstanceTransform, model) + i * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(4 + i);
+        //Advance once per instance instead of once per vertex
+        glVertexAttribDivisor(4 + i, 1);
+    }
+    //A mat3 takes up three vec3 locations
+    for (unsigned int i = 0; normalMatrix && i < 3; i++)
+    {
+        glVertexAttribPointer(8 + i, 3, GL_FLOAT, GL_FALSE, (GLsizei)stride, (void*)(offset + offsetof(InstanceTransform, normalMatrix) + i * sizeof(glm::vec3)));
+        glEnableVertexAttribArray(8 + i);
+        glVertexAttribDivisor(8 + i, 1);
+    }
+    if (normalMatrix)
+    {
+        //Integer attribute, read as a uint without conversion
+        glVertexAttribIPointer(11, 1, GL_UNSIGNED_INT, (GLsizei)stride, (void*)(offset + offsetof(InstanceTransform, material)));
+        glEnableVertexAttribArray(11);
+        glVertexAttribDivisor(11, 1);
+    }
+}
+
+//Drop every shader feature the cubes won't show this frame: a layer every material's mix value hides completely,
+//vertex colors when turned off, specular when every material's strength is 0, and the light grid lookup when there's only one light
+unsigned int cubeShaderFeatures(const MaterialTable& materialTable)
+{
+    unsigned int features = 0;
+    float minMix, maxMix, maxSpecular;
+    materialTable.ranges(minMix, maxMix, maxSpecular);
+    if (minMix >= 1.0f)
+        features |= CUBE_NO_TEXTURE1;
+    else if (maxMix <= 0.0f)
+        features |= CUBE_NO_TEXTURE2;
+    if (!useVertexColors)
+        features |= CUBE_NO_VERTEX_COLOR;
+    if (maxSpecular <= 0.0f)
+        features |= CUBE_SPECULAR_OFF;
+    if (lightCount == 1)
+        features |= CUBE_SINGLE_LIGHT;
+    return features;
+}
+
+//The container and face mix every cube used to share, from the mix value and light strength the keys and FrameData use
+Material firstMaterial(unsigned int layer1, unsigned int layer2)
+{
+    Material material;
+    material.layer1 = layer1;
+    material.layer2 = layer2;
+    material.mixValue = mixValue;
+    material.ambientStrength = ambientLightStrength;
+    material.specularStrength = specularLightStrength;
+    return material;
+}
+
+//Model matrix at 4-7 and color at 8 of each LightInstance, starting at offset in buffer
+void setLightInstanceAttributes(RenderState& state, unsigned int VAO, unsigned int buffer, size_t offset)
+{
+    setInstanceAttributes(state, VAO, buffer, offset + offsetof(LightInstance, model), sizeof(LightInstance), false);
+    glVertexAttribPointer(8, 4, GL_FLOAT, GL_FALSE, sizeof(LightInstance), (void*)(offset + offsetof(LightInstance, color)));
+    glEnableVertexAttribArray(8);
+    glVertexAttribDivisor(8, 1);
+}
+
+//True only on the frame a key goes down, so toggles flip once per press
+bool keyPressedOnce(GLFWwindow* window, int key, bool& wasDown)
+{
+    bool down = glfwGetKey(window, key) == GLFW_PRESS;
+    bool pressed = down && !wasDown;
+    wasDown = down;
+    return pressed;
+}
+
+//Same spin as cubeModelMatrix in batch form, even indexed cubes turn at 10 degrees a second and odd ones never move.
+//The first ten cubes keep the first material, the rest cycle through all materialCount
+void buildCubeTransforms(TransformBatch& batch, const std::vector<glm::vec3>& positions, unsigned int materialCount)
+{
+    std::vector<glm::vec3> axes(positions.size(), glm::vec3(1.0f, 1.0f, 0.0f));
+    std::vector<float> baseAngles(positions.size());
+    std::vector<float> angularSpeeds(positions.size());
+    std::vector<unsigned int> materials(positions.size());
+    for (unsigned int i = 0; i < positions.size(); i++)
+    {
+        baseAngles[i] = glm::radians(i * 20.0f);
+        angularSpeeds[i] = i % 2 == 0 ? glm::radians(10.0f) : 0.0f;
+        materials[i] = i < 10 ? 0 : i % materialCount;
+    }
+    batch.build(positions, axes, baseAngles, angularSpeeds, materials);
+}
+
+//Times cubeModelMatrix plus an inverse transpose per object against TransformBatch for 1k to 1M objects on one thread, prints
+//nanoseconds per object and writes them to benchmarkOutput. Also reports the largest difference between the two paths
+int runTransformBenchmark()
+{
+    typedef std::chrono::steady_clock Clock;
+    const unsigned int COUNTS[] = { 1000, 10000, 100000, 1000000 };
+    const unsigned int TARGET_OBJECTS = 20000000;
+    std::ostringstream json;
+    json << "{ \"lanes\": " << WideLanes::WIDTH << ", \"results\": [";
+    srand(1337);
+    for (unsigned int test = 0; test < sizeof(COUNTS) / sizeof(COUNTS[0]); test++)
+    {
+        unsigned int count = COUNTS[test];
+        std::vector<glm::vec3> positions(count);
+        for (glm::vec3& position : positions)
+            position = glm::vec3(rand() / (float)RAND_MAX, rand() / (float)RAND_MAX, rand() / (float)RAND_MAX) * 100.0f - 50.0f;
+        std::vector<unsigned int> objects(count);
+        for (unsigned int i = 0; i < count; i++)
+            objects[i] = i;
+        TransformBatch batch;
+        buildCubeTransforms(batch, positions, 1);
+        std::vector<InstanceTransform> reference(count);
+        std::vector<InstanceTransform> batched(count);
+        //Enough passes over small counts that the timings aren't just clock noise
+        unsigned int passes = TARGET_OBJECTS / count;
+
+        Clock::time_point start = Clock::now();
+        for (unsigned int pass = 0; pass < passes; pass++)
+        {
+            float time = pass * 0.016f;
+            for (unsigned int i = 0; i < count; i++)
+            {
+                reference[i].model = cubeModelMatrix(i, positions[i], time);
+                reference[i].normalMatrix = glm::transpose(glm::inverse(glm::mat3(reference[i].model)));
+            }
+        }
+        double glmNanoseconds = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ((double)passes * count);
+
+        start = Clock::now();
+        for (unsigned int pass = 0; pass < passes; pass++)
+            batch.write(pass * 0.016f, objects.data(), count, batched.data());
+        double batchNanoseconds = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ((double)passes * count);
+
+        //Both end on the same time, so the last pass of each can be compared directly
+        float maxError = 0.0f;
+        for (unsigned int i = 0; i < count; i++)
+        {
+            for (unsigned int column = 0; column < 4; column++)
+            {
+                for (unsigned int row = 0; row < 4; row++)
+                    maxError = std::max(maxError, std::abs(reference[i].model[column][row] - batched[i].model[column][row]));
+            }
+            for (unsigned int column = 0; column < 3; column++)
+            {
+                for (unsigned int row = 0; row < 3; row++)
+                    maxError = std::max(maxError, std::abs(reference[i].normalMatrix[column][row] - batched[i].normalMatrix[column][row]));
+            }
+        }
+
+        std::cout << count << " objects: glm " << glmNanoseconds << " ns, batch " << batchNanoseconds << " ns per object ("
+            << glmNanoseconds / batchNanoseconds << "x), max difference " << maxError << std::endl;
+        json << (test > 0 ? ", " : "") << "{ \"objects\": " << count
+            << ", \"glm_ns\": " << glmNanoseconds
+            << ", \"batch_ns\": " << batchNanoseconds
+            << ", \"speedup\": " << glmNanoseconds / batchNanoseconds
+            << ", \"max_difference\": " << maxError << " }";
+    }
+    json << "] }\n";
+    std::ofstream file(benchmarkOutput);
+    if (!file)
+    {
+        std::cout << "ERROR::BENCHMARK::FAILED_TO_WRITE " << benchmarkOutput << std::endl;
+        return -1;
+    }
+    file << json.str();
+    return 0;
+}
+
+//Model matrix for a cube, spins even indexed cubes over time and offsets all cube spins
+glm::mat4 cubeModelMatrix(unsigned int index, const glm::vec3& position, float time)
+{
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, position);
+    if ((index + 2) % 2 == 0)
+    {
+        model = glm::rotate(model, glm::radians((time * 10.0f) + (index * 20.0f)), glm::vec3(1.0f, 1.0f, 0.0f));
+    }
+    else
+    {
+        model = glm::rotate(model, glm::radians(index * 20.0f), glm::vec3(1.0f, 1.0f, 0.0f));
     }
+    return model;
 }
 
 //Callback for mouse movement (camera mouse controls)
@@ -421,9 +1740,9 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 }
 
 
-//Called on window size change (by user or OS)
+//Called on window size change (by user or OS). The render loop resizes its targets and viewports to match on the next frame
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-    //matches viewport to window dimensions on init and resize
-    glViewport(0, 0, width, height);
+    framebufferWidth = width;
+    framebufferHeight = height;
 }
\ No newline at end of file
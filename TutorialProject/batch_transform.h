@@ -0,0 +1,340 @@
+#ifndef BATCH_TRANSFORM_H
+#define BATCH_TRANSFORM_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+
+//SSE2 is always there on x64. AVX2 is used when the compiler targets it (/arch:AVX2, -mavx2), otherwise the kernels run 4 wide
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BATCH_TRANSFORM_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(BATCH_TRANSFORM_SSE2) && defined(__AVX2__)
+#define BATCH_TRANSFORM_AVX2
+#include <immintrin.h>
+#endif
+
+//Per instance data as the vertex shaders read it. Objects only rotate and translate, so the normal matrix is just the rotation
+struct InstanceTransform
+{
+    glm::mat4 model;
+    glm::mat3 normalMatrix;
+    //Index into the MaterialTable
+    unsigned int material;
+};
+
+//Vector sin/cos: Cody-Waite reduction by pi/2 and Cephes' single precision polynomials on [-pi/4, pi/4], good to a few ulp for
+//angles up to a few thousand radians. Simd is one of the lane types below, the same code serves every width
+template <typename Simd>
+inline void sinCos(typename Simd::Float x, typename Simd::Float& sine, typename Simd::Float& cosine)
+{
+    typedef typename Simd::Float Float;
+    typedef typename Simd::Int Int;
+    Int quadrant = Simd::roundToInt(Simd::mul(x, Simd::set1(0.63661977236f)));
+    Float q = Simd::toFloat(quadrant);
+    Float r = Simd::sub(x, Simd::mul(q, Simd::set1(1.5703125f)));
+    r = Simd::sub(r, Simd::mul(q, Simd::set1(4.837512969970703125e-4f)));
+    r = Simd::sub(r, Simd::mul(q, Simd::set1(7.54978995489188216e-8f)));
+    Float r2 = Simd::mul(r, r);
+
+    Float s = Simd::add(Simd::mul(Simd::set1(-1.9515295891e-4f), r2), Simd::set1(8.3321608736e-3f));
+    s = Simd::add(Simd::mul(s, r2), Simd::set1(-1.6666654611e-1f));
+    s = Simd::add(Simd::mul(Simd::mul(s, r2), r), r);
+    Float c = Simd::add(Simd::mul(Simd::set1(2.443315711809948e-5f), r2), Simd::set1(-1.388731625493765e-3f));
+    c = Simd::add(Simd::mul(c, r2), Simd::set1(4.166664568298827e-2f));
+    c = Simd::add(Simd::mul(Simd::mul(c, r2), r2), Simd::sub(Simd::set1(1.0f), Simd::mul(r2, Simd::set1(0.5f))));
+
+    //Quadrant 1 and 3 swap the two, quadrants 1 and 2 negate cos, 2 and 3 negate sin
+    Float swap = Simd::bitSet(quadrant, 1);
+    sine = Simd::select(swap, c, s);
+    cosine = Simd::select(swap, s, c);
+    sine = Simd::negateWhere(Simd::bitSet(quadrant, 2), sine);
+    cosine = Simd::negateWhere(Simd::bitSet(Simd::addInt(quadrant, 1), 2), cosine);
+}
+
+//One lane, for targets without SSE2 and for the odd objects left over at the end of a batch
+struct ScalarLanes
+{
+    static const unsigned int WIDTH = 1;
+    typedef float Float;
+    typedef std::int32_t Int;
+    static Float load(const float* p) { return *p; }
+    static void store(float* p, Float v) { *p = v; }
+    static Float set1(float v) { return v; }
+    static Float add(Float a, Float b) { return a + b; }
+    static Float sub(Float a, Float b) { return a - b; }
+    static Float mul(Float a, Float b) { return a * b; }
+    static Int roundToInt(Float v) { return (Int)std::floor(v + 0.5f); }
+    static Float toFloat(Int v) { return (Float)v; }
+    static Int addInt(Int a, Int b) { return a + b; }
+    //All bits set where the bit is set, as a float mask
+    static Float bitSet(Int v, Int bit)
+    {
+        std::uint32_t mask = (v & bit) ? 0xFFFFFFFFu : 0u;
+        Float result;
+        std::memcpy(&result, &mask, sizeof(Float));
+        return result;
+    }
+    static Float select(Float mask, Float a, Float b)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &mask, sizeof(Float));
+        return bits ? a : b;
+    }
+    static Float negateWhere(Float mask, Float v)
+    {
+        return select(mask, -v, v);
+    }
+};
+
+#ifdef BATCH_TRANSFORM_SSE2
+struct SseLanes
+{
+    static const unsigned int WIDTH = 4;
+    typedef __m128 Float;
+    typedef __m128i Int;
+    static Float load(const float* p) { return _mm_load_ps(p); }
+    static void store(float* p, Float v) { _mm_store_ps(p, v); }
+    static Float set1(float v) { return _mm_set1_ps(v); }
+    static Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+    static Float sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+    static Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+    //Rounds to nearest under the default MXCSR mode
+    static Int roundToInt(Float v) { return _mm_cvtps_epi32(v); }
+    static Float toFloat(Int v) { return _mm_cvtepi32_ps(v); }
+    static Int addInt(Int a, int b) { return _mm_add_epi32(a, _mm_set1_epi32(b)); }
+    static Float bitSet(Int v, int bit)
+    {
+        Int masked = _mm_and_si128(v, _mm_set1_epi32(bit));
+        return _mm_castsi128_ps(_mm_cmpeq_epi32(masked, _mm_set1_epi32(bit)));
+    }
+    static Float select(Float mask, Float a, Float b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+    static Float negateWhere(Float mask, Float v) { return _mm_xor_ps(v, _mm_and_ps(mask, _mm_set1_ps(-0.0f))); }
+};
+#endif
+
+#ifdef BATCH_TRANSFORM_AVX2
+struct AvxLanes
+{
+    static const unsigned int WIDTH = 8;
+    typedef __m256 Float;
+    typedef __m256i Int;
+    static Float load(const float* p) { return _mm256_load_ps(p); }
+    static void store(float* p, Float v) { _mm256_store_ps(p, v); }
+    static Float set1(float v) { return _mm256_set1_ps(v); }
+    static Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+    static Float sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+    static Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+    static Int roundToInt(Float v) { return _mm256_cvtps_epi32(v); }
+    static Float toFloat(Int v) { return _mm256_cvtepi32_ps(v); }
+    static Int addInt(Int a, int b) { return _mm256_add_epi32(a, _mm256_set1_epi32(b)); }
+    static Float bitSet(Int v, int bit)
+    {
+        Int masked = _mm256_and_si256(v, _mm256_set1_epi32(bit));
+        return _mm256_castsi256_ps(_mm256_cmpeq_epi32(masked, _mm256_set1_epi32(bit)));
+    }
+    static Float select(Float mask, Float a, Float b) { return _mm256_blendv_ps(b, a, mask); }
+    static Float negateWhere(Float mask, Float v) { return _mm256_xor_ps(v, _mm256_and_ps(mask, _mm256_set1_ps(-0.0f))); }
+};
+typedef AvxLanes WideLanes;
+#elif defined(BATCH_TRANSFORM_SSE2)
+typedef SseLanes WideLanes;
+#else
+typedef ScalarLanes WideLanes;
+#endif
+
+//Objects that spin about a fixed axis at a fixed position, stored as structure of arrays so the kernels read whole lanes at once.
+//Objects with no angular speed never change, their transforms are built once in build() and copied from then on
+class TransformBatch
+{
+public:
+    static const unsigned int NOT_STATIC = 0xFFFFFFFFu;
+
+    //angle = baseAngle + angularSpeed * time, both in radians. Axes don't have to be normalized. Materials are copied into every transform
+    void build(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& axes, const std::vector<float>& baseAngles, const std::vector<float>& angularSpeeds,
+        const std::vector<unsigned int>& materialIndices)
+    {
+        size_t count = positions.size();
+        px.resize(count);
+        py.resize(count);
+        pz.resize(count);
+        ax.resize(count);
+        ay.resize(count);
+        az.resize(count);
+        base.resize(count);
+        speed.resize(count);
+        materials = materialIndices;
+        staticSlots.assign(count, (unsigned int)NOT_STATIC);
+        staticTransforms.clear();
+        for (size_t i = 0; i < count; i++)
+        {
+            glm::vec3 axis = glm::normalize(axes[i]);
+            px[i] = positions[i].x;
+            py[i] = positions[i].y;
+            pz[i] = positions[i].z;
+            ax[i] = axis.x;
+            ay[i] = axis.y;
+            az[i] = axis.z;
+            //Keeps the reduction in sinCos short and accurate however large the authored angle is
+            base[i] = (float)std::remainder((double)baseAngles[i], 6.283185307179586);
+            speed[i] = angularSpeeds[i];
+        }
+        for (unsigned int i = 0; i < count; i++)
+        {
+            if (speed[i] != 0.0f)
+                continue;
+            unsigned int slot = (unsigned int)staticTransforms.size();
+            staticSlots[i] = slot;
+            staticTransforms.emplace_back();
+            computeLanes<ScalarLanes>(0.0f, &i, 1, staticTransforms.data(), &slot);
+        }
+    }
+
+    size_t size() const
+    {
+        return px.size();
+    }
+
+    //Transforms of objects[0..count) at time into out[0..count). Static objects are copied, the animated ones are gathered up a
+    //full SIMD width at a time. Touches nothing shared, so disjoint ranges can be written from different threads
+    void write(float time, const unsigned int* objects, unsigned int count, InstanceTransform* out) const
+    {
+        const unsigned int WIDTH = WideLanes::WIDTH;
+        unsigned int lanes[WIDTH];
+        unsigned int slots[WIDTH];
+        unsigned int pending = 0;
+        for (unsigned int i = 0; i < count; i++)
+        {
+            unsigned int object = objects[i];
+            if (staticSlots[object] != NOT_STATIC)
+            {
+                out[i] = staticTransforms[staticSlots[object]];
+                continue;
+            }
+            lanes[pending] = object;
+            slots[pending] = i;
+            if (++pending == WIDTH)
+            {
+                computeLanes<WideLanes>(time, lanes, WIDTH, out, slots);
+                pending = 0;
+            }
+        }
+        for (unsigned int i = 0; i < pending; i++)
+            computeLanes<ScalarLanes>(time, &lanes[i], 1, out, &slots[i]);
+    }
+
+private:
+    std::vector<float> px, py, pz;
+    std::vector<float> ax, ay, az;
+    std::vector<float> base, speed;
+    std::vector<unsigned int> materials;
+    //Index into staticTransforms, NOT_STATIC for animated objects
+    std::vector<unsigned int> staticSlots;
+    std::vector<InstanceTransform> staticTransforms;
+
+    //Simd::WIDTH objects, out[slots[k]] gets object lanes[k]. Same rotation matrix as glm::rotate, translation in the last column
+    template <typename Simd>
+    void computeLanes(float time, const unsigned int* lanes, unsigned int count, InstanceTransform* out, const unsigned int* slots) const
+    {
+        typedef typename Simd::Float Float;
+        const unsigned int WIDTH = Simd::WIDTH;
+        alignas(32) float gathered[4][WIDTH];
+        for (unsigned int k = 0; k < count; k++)
+        {
+            unsigned int object = lanes[k];
+            gathered[0][k] = base[object] + speed[object] * time;
+            gathered[1][k] = ax[object];
+            gathered[2][k] = ay[object];
+            gathered[3][k] = az[object];
+        }
+        Float sine, cosine;
+        sinCos<Simd>(Simd::load(gathered[0]), sine, cosine);
+        Float x = Simd::load(gathered[1]);
+        Float y = Simd::load(gathered[2]);
+        Float z = Simd::load(gathered[3]);
+        Float oneMinusCos = Simd::sub(Simd::set1(1.0f), cosine);
+        Float tx = Simd::mul(oneMinusCos, x);
+        Float ty = Simd::mul(oneMinusCos, y);
+        Float tz = Simd::mul(oneMinusCos, z);
+        Float sx = Simd::mul(sine, x);
+        Float sy = Simd::mul(sine, y);
+        Float sz = Simd::mul(sine, z);
+        //rotation[column * 3 + row] for every lane
+        alignas(32) float rotation[9][WIDTH];
+        Simd::store(rotation[0], Simd::add(cosine, Simd::mul(tx, x)));
+        Simd::store(rotation[1], Simd::add(Simd::mul(tx, y), sz));
+        Simd::store(rotation[2], Simd::sub(Simd::mul(tx, z), sy));
+        Simd::store(rotation[3], Simd::sub(Simd::mul(ty, x), sz));
+        Simd::store(rotation[4], Simd::add(cosine, Simd::mul(ty, y)));
+        Simd::store(rotation[5], Simd::add(Simd::mul(ty, z), sx));
+        Simd::store(rotation[6], Simd::add(Simd::mul(tz, x), sy));
+        Simd::store(rotation[7], Simd::sub(Simd::mul(tz, y), sx));
+        Simd::store(rotation[8], Simd::add(cosine, Simd::mul(tz, z)));
+        storeLanes(rotation[0], WIDTH, lanes, count, out, slots);
+    }
+
+    //Scatter lane-major rotations into the instances. With SSE2 four lanes at a time are transposed into columns in registers
+    void storeLanes(const float* rotation, unsigned int stride, const unsigned int* lanes, unsigned int count, InstanceTransform* out, const unsigned int* slots) const
+    {
+        unsigned int k = 0;
+#ifdef BATCH_TRANSFORM_SSE2
+        for (; k + 4 <= count; k += 4)
+        {
+            __m128 zero = _mm_setzero_ps();
+            __m128 columns[3][4];
+            for (unsigned int column = 0; column < 3; column++)
+            {
+                __m128 r0 = _mm_loadu_ps(rotation + (column * 3 + 0) * stride + k);
+                __m128 r1 = _mm_loadu_ps(rotation + (column * 3 + 1) * stride + k);
+                __m128 r2 = _mm_loadu_ps(rotation + (column * 3 + 2) * stride + k);
+                __m128 r3 = zero;
+                _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                columns[column][0] = r0;
+                columns[column][1] = r1;
+                columns[column][2] = r2;
+                columns[column][3] = r3;
+            }
+            for (unsigned int lane = 0; lane < 4; lane++)
+            {
+                unsigned int object = lanes[k + lane];
+                InstanceTransform& transform = out[slots[k + lane]];
+                float* model = &transform.model[0][0];
+                _mm_storeu_ps(model, columns[0][lane]);
+                _mm_storeu_ps(model + 4, columns[1][lane]);
+                _mm_storeu_ps(model + 8, columns[2][lane]);
+                _mm_storeu_ps(model + 12, _mm_setr_ps(px[object], py[object], pz[object], 1.0f));
+                //Overlapping stores, each column's fourth float is overwritten by the next column. The last one stops at three
+                float* normal = &transform.normalMatrix[0][0];
+                _mm_storeu_ps(normal, columns[0][lane]);
+                _mm_storeu_ps(normal + 3, columns[1][lane]);
+                _mm_storel_pi((__m64*)(normal + 6), columns[2][lane]);
+                _mm_store_ss(normal + 8, _mm_movehl_ps(columns[2][lane], columns[2][lane]));
+                transform.material = materials[object];
+            }
+        }
+#endif
+        for (; k < count; k++)
+        {
+            unsigned int object = lanes[k];
+            InstanceTransform& transform = out[slots[k]];
+            for (unsigned int column = 0; column < 3; column++)
+            {
+                for (unsigned int row = 0; row < 3; row++)
+                {
+                    float value = rotation[(column * 3 + row) * stride + k];
+                    transform.model[column][row] = value;
+                    transform.normalMatrix[column][row] = value;
+                }
+                transform.model[column][3] = 0.0f;
+            }
+            transform.model[3] = glm::vec4(px[object], py[object], pz[object], 1.0f);
+            transform.material = materials[object];
+        }
+    }
+};
+
+#endif
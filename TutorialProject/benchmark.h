@@ -0,0 +1,142 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <glad/glad.h>
+#include "gpu_query_ring.h"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+//Draw submission counters, reset at the start of every frame
+struct FrameStats
+{
+    unsigned int drawCalls = 0;
+    unsigned long long triangles = 0;
+};
+
+//Frame GPU time, read back LATENCY - 1 frames later so the CPU never waits on it
+class GpuFrameTimer : public GpuQueryRing<GL_TIME_ELAPSED>
+{
+public:
+    //Milliseconds for the frame issued LATENCY - 1 frames ago, false if there isn't one yet or it isn't ready
+    bool collect(unsigned int frame, double& milliseconds)
+    {
+        GLuint64 nanoseconds = 0;
+        if (!GpuQueryRing::collect(frame, nanoseconds))
+            return false;
+        milliseconds = nanoseconds / 1000000.0;
+        return true;
+    }
+};
+
+//Samples that passed the depth test between begin and end, read back LATENCY - 1 frames later like GpuFrameTimer.
+//Wrapped around the cube shading draw, once every frame, it counts shaded fragments so overdraw shows up directly
+class GpuSampleCounter : public GpuQueryRing<GL_SAMPLES_PASSED>
+{
+public:
+    //Samples for the frame issued LATENCY - 1 frames ago, false if there isn't one yet or it isn't ready
+    bool collect(unsigned int frame, double& samples)
+    {
+        GLuint64 passed = 0;
+        if (!GpuQueryRing::collect(frame, passed))
+            return false;
+        samples = (double)passed;
+        return true;
+    }
+};
+
+//Per frame samples for a benchmark run, summarized as percentiles in JSON
+class BenchmarkRecorder
+{
+public:
+    std::vector<double> cpuMilliseconds;
+    std::vector<double> gpuMilliseconds;
+    std::vector<double> drawCalls;
+    std::vector<double> triangles;
+    std::vector<double> shadedSamples;
+    std::vector<double> latencyMilliseconds;
+
+    void addFrame(double cpuTime, const FrameStats& stats)
+    {
+        cpuMilliseconds.push_back(cpuTime);
+        drawCalls.push_back(stats.drawCalls);
+        triangles.push_back((double)stats.triangles);
+    }
+    void addGpuTime(double gpuTime)
+    {
+        gpuMilliseconds.push_back(gpuTime);
+    }
+    void addShadedSamples(double samples)
+    {
+        shadedSamples.push_back(samples);
+    }
+    void addLatency(double latency)
+    {
+        latencyMilliseconds.push_back(latency);
+    }
+
+    //settings is written as-is as the "settings" object, so it should already be valid JSON
+    std::string toJson(const std::string& settings) const
+    {
+        std::ostringstream json;
+        json << "{\n";
+        json << "  \"settings\": " << settings << ",\n";
+        json << "  \"frames\": " << cpuMilliseconds.size() << ",\n";
+        json << "  \"cpu_ms\": " << summary(cpuMilliseconds) << ",\n";
+        json << "  \"gpu_ms\": " << summary(gpuMilliseconds) << ",\n";
+        json << "  \"draw_calls\": " << summary(drawCalls) << ",\n";
+        json << "  \"triangles\": " << summary(triangles) << ",\n";
+        json << "  \"shaded_samples\": " << summary(shadedSamples) << ",\n";
+        json << "  \"latency_ms\": " << summary(latencyMilliseconds) << "\n";
+        json << "}\n";
+        return json.str();
+    }
+
+    bool writeJson(const std::string& path, const std::string& settings) const
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::BENCHMARK::FAILED_TO_WRITE " << path << std::endl;
+            return false;
+        }
+        file << toJson(settings);
+        return true;
+    }
+
+private:
+    //Nearest rank percentile of sorted samples
+    static double percentile(const std::vector<double>& sorted, double p)
+    {
+        if (sorted.empty())
+            return 0.0;
+        size_t rank = (size_t)(p / 100.0 * (sorted.size() - 1) + 0.5);
+        return sorted[std::min(rank, sorted.size() - 1)];
+    }
+
+    static std::string summary(std::vector<double> samples)
+    {
+        std::sort(samples.begin(), samples.end());
+        double mean = 0.0;
+        for (double sample : samples)
+            mean += sample;
+        if (!samples.empty())
+            mean /= samples.size();
+        std::ostringstream json;
+        json << "{ \"count\": " << samples.size()
+            << ", \"mean\": " << mean
+            << ", \"min\": " << (samples.empty() ? 0.0 : samples.front())
+            << ", \"p50\": " << percentile(samples, 50.0)
+            << ", \"p90\": " << percentile(samples, 90.0)
+            << ", \"p95\": " << percentile(samples, 95.0)
+            << ", \"p99\": " << percentile(samples, 99.0)
+            << ", \"max\": " << (samples.empty() ? 0.0 : samples.back()) << " }";
+        return json.str();
+    }
+};
+
+#endif
@@ -87,6 +87,14 @@ public:
         updateCameraVectors();
     }
 
+    //Sets the Euler angles directly, for scripted camera paths
+    void SetOrientation(float yaw, float pitch)
+    {
+        Yaw = yaw;
+        Pitch = pitch;
+        updateCameraVectors();
+    }
+
     void ProcessMouseScroll(float yoffset)
     {
         Zoom -= (float)yoffset;
@@ -0,0 +1,208 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+//Six normalized planes (left, right, bottom, top, near, far) pulled out of a view-projection matrix, stored SoA.
+//A point is inside when a*x + b*y + c*z + d >= 0 for every plane
+struct Frustum
+{
+    float a[6];
+    float b[6];
+    float c[6];
+    float d[6];
+
+    static Frustum fromMatrix(const glm::mat4& viewProjection)
+    {
+        //Gribb/Hartmann: each plane is the fourth row plus or minus one of the other rows
+        const glm::mat4& m = viewProjection;
+        Frustum frustum;
+        for (int i = 0; i < 6; i++)
+        {
+            int row = i / 2;
+            float sign = (i % 2 == 0) ? 1.0f : -1.0f;
+            glm::vec4 plane(m[0][3] + sign * m[0][row], m[1][3] + sign * m[1][row], m[2][3] + sign * m[2][row], m[3][3] + sign * m[3][row]);
+            float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+            frustum.a[i] = plane.x / length;
+            frustum.b[i] = plane.y / length;
+            frustum.c[i] = plane.z / length;
+            frustum.d[i] = plane.w / length;
+        }
+        return frustum;
+    }
+};
+
+struct CullingStats
+{
+    unsigned int visible = 0;
+    unsigned int culled = 0;
+    unsigned int cellsVisible = 0;
+    unsigned int cellsCulled = 0;
+    //Inside the frustum but hidden behind the depth pyramid
+    unsigned int occluded = 0;
+};
+
+//Uniform grid over static bounding spheres. Whole cells are rejected or accepted by their bounds first,
+//only objects in cells straddling a plane get the per-sphere test
+class SceneGrid
+{
+public:
+    //Rebuild the grid, object i is the sphere centers[i] / radii[i]
+    void build(const std::vector<glm::vec3>& centers, const std::vector<float>& radii, float cellSize)
+    {
+        size_t count = centers.size();
+        std::vector<std::pair<std::uint64_t, unsigned int>> keyed(count);
+        for (size_t i = 0; i < count; i++)
+            keyed[i] = std::make_pair(cellKey(centers[i], cellSize), (unsigned int)i);
+        //Objects in the same cell end up next to each other so each cell is one contiguous SoA range
+        std::sort(keyed.begin(), keyed.end());
+
+        centerX.resize(count);
+        centerY.resize(count);
+        centerZ.resize(count);
+        radius.resize(count);
+        objectIndex.resize(count);
+        cells.clear();
+        for (size_t i = 0; i < count; i++)
+        {
+            unsigned int object = keyed[i].second;
+            const glm::vec3& center = centers[object];
+            float r = radii[object];
+            centerX[i] = center.x;
+            centerY[i] = center.y;
+            centerZ[i] = center.z;
+            radius[i] = r;
+            objectIndex[i] = object;
+            if (i == 0 || keyed[i].first != keyed[i - 1].first)
+            {
+                Cell cell;
+                cell.min = center - r;
+                cell.max = center + r;
+                cell.begin = (unsigned int)i;
+                cells.push_back(cell);
+            }
+            Cell& cell = cells.back();
+            cell.min = glm::min(cell.min, center - r);
+            cell.max = glm::max(cell.max, center + r);
+            cell.end = (unsigned int)i + 1;
+        }
+        inside.resize(count);
+    }
+
+    //Replace visible with the original index of every object touching the frustum
+    void cull(const Frustum& frustum, std::vector<unsigned int>& visible, CullingStats& stats)
+    {
+        visible.clear();
+        cullCells(frustum, 0, cellCount(), visible, stats);
+    }
+
+    //Append the objects touching the frustum from cells [firstCell, lastCell) to visible, stats cover just those cells.
+    //Disjoint cell ranges can be culled on different threads at once
+    void cullCells(const Frustum& frustum, unsigned int firstCell, unsigned int lastCell, std::vector<unsigned int>& visible, CullingStats& stats)
+    {
+        size_t visibleBefore = visible.size();
+        stats = CullingStats();
+        for (unsigned int c = firstCell; c < lastCell; c++)
+        {
+            const Cell& cell = cells[c];
+            int result = testBox(frustum, cell.min, cell.max);
+            if (result == OUTSIDE)
+            {
+                stats.cellsCulled++;
+                continue;
+            }
+            stats.cellsVisible++;
+            if (result == INSIDE)
+            {
+                visible.insert(visible.end(), objectIndex.begin() + cell.begin, objectIndex.begin() + cell.end);
+                continue;
+            }
+            testSpheres(frustum, cell.begin, cell.end);
+            for (unsigned int i = cell.begin; i < cell.end; i++)
+            {
+                if (inside[i])
+                    visible.push_back(objectIndex[i]);
+            }
+        }
+        unsigned int objects = firstCell < lastCell ? cells[lastCell - 1].end - cells[firstCell].begin : 0;
+        stats.visible = (unsigned int)(visible.size() - visibleBefore);
+        stats.culled = objects - stats.visible;
+    }
+
+    unsigned int cellCount() const
+    {
+        return (unsigned int)cells.size();
+    }
+
+private:
+    enum { OUTSIDE, INTERSECTS, INSIDE };
+    struct Cell
+    {
+        glm::vec3 min;
+        glm::vec3 max;
+        unsigned int begin;
+        unsigned int end;
+    };
+    std::vector<Cell> cells;
+    //Object bounds sorted by cell
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> radius;
+    std::vector<unsigned int> objectIndex;
+    //Per object result of the last sphere test, 1 = visible
+    std::vector<unsigned char> inside;
+
+    static std::uint64_t cellKey(const glm::vec3& position, float cellSize)
+    {
+        //21 bits per axis, offset so negative cells stay positive
+        std::uint64_t x = (std::uint64_t)((std::int64_t)std::floor(position.x / cellSize) + (1 << 20)) & 0x1FFFFF;
+        std::uint64_t y = (std::uint64_t)((std::int64_t)std::floor(position.y / cellSize) + (1 << 20)) & 0x1FFFFF;
+        std::uint64_t z = (std::uint64_t)((std::int64_t)std::floor(position.z / cellSize) + (1 << 20)) & 0x1FFFFF;
+        return (x << 42) | (y << 21) | z;
+    }
+
+    //Outside if the corner furthest along a plane's normal is behind it, inside if the nearest corner is in front of all of them
+    static int testBox(const Frustum& frustum, const glm::vec3& min, const glm::vec3& max)
+    {
+        int result = INSIDE;
+        for (int p = 0; p < 6; p++)
+        {
+            float px = frustum.a[p] >= 0.0f ? max.x : min.x;
+            float py = frustum.b[p] >= 0.0f ? max.y : min.y;
+            float pz = frustum.c[p] >= 0.0f ? max.z : min.z;
+            if (frustum.a[p] * px + frustum.b[p] * py + frustum.c[p] * pz + frustum.d[p] < 0.0f)
+                return OUTSIDE;
+            float nx = frustum.a[p] >= 0.0f ? min.x : max.x;
+            float ny = frustum.b[p] >= 0.0f ? min.y : max.y;
+            float nz = frustum.c[p] >= 0.0f ? min.z : max.z;
+            if (frustum.a[p] * nx + frustum.b[p] * ny + frustum.c[p] * nz + frustum.d[p] < 0.0f)
+                result = INTERSECTS;
+        }
+        return result;
+    }
+
+    //Branch free loop over contiguous SoA arrays so the compiler can vectorize it
+    void testSpheres(const Frustum& frustum, unsigned int begin, unsigned int end)
+    {
+        const float* x = centerX.data();
+        const float* y = centerY.data();
+        const float* z = centerZ.data();
+        const float* r = radius.data();
+        unsigned char* result = inside.data();
+        for (unsigned int i = begin; i < end; i++)
+        {
+            float nearest = frustum.a[0] * x[i] + frustum.b[0] * y[i] + frustum.c[0] * z[i] + frustum.d[0];
+            for (int p = 1; p < 6; p++)
+                nearest = std::min(nearest, frustum.a[p] * x[i] + frustum.b[p] * y[i] + frustum.c[p] * z[i] + frustum.d[p]);
+            result[i] = nearest >= -r[i] ? 1 : 0;
+        }
+    }
+};
+
+#endif
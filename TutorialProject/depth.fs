@@ -0,0 +1,6 @@
+#version 330 core
+//Depth-only pre-pass, color writes are masked off so there's nothing to output
+
+void main()
+{
+}
@@ -0,0 +1,19 @@
+#version 330 core
+//Depth-only pre-pass for the cubes. Position math matches shader.vs exactly and both declare gl_Position invariant,
+//so the shading pass can test against this depth with GL_EQUAL
+layout (location = 0) in vec3 aPos;
+//Per instance model matrix, only read when drawing instanced
+layout (location = 4) in mat4 aInstanceModel;
+
+//FrameData (camera and light data, written once per frame by main()) is inserted by Shader, see FRAME_DATA_GLSL
+
+uniform mat4 model;
+uniform bool instanced;
+
+invariant gl_Position;
+
+void main()
+{
+   mat4 modelMatrix = instanced ? aInstanceModel : model;
+   gl_Position = viewProjection * modelMatrix * vec4(aPos, 1.0);
+}
\ No newline at end of file
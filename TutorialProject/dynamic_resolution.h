@@ -0,0 +1,137 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "shader_s.h"
+#include "render_state.h"
+#include "render_target.h"
+#include "fullscreen_triangle.h"
+#include "benchmark.h"
+
+#include <cmath>
+#include <algorithm>
+
+//Picks the scene's render scale from measured GPU frame times. GPU time is taken to follow the pixel count, scale squared,
+//so the scale that would just fit is scale * sqrt(target / measured). Times are averaged, the scale moves in whole steps,
+//and the frames still in flight at the old scale are skipped after every change, so it settles instead of oscillating
+class ResolutionController
+{
+public:
+    //Frames averaged before the first decision after a change
+    static const unsigned int MIN_SAMPLES = 8;
+
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    //Scales are whole multiples of this, so the render size only changes when it's worth it
+    float step = 0.05f;
+    //GPU milliseconds per frame to stay under
+    double targetMilliseconds = 16.0;
+    float scale = 1.0f;
+
+    //Feed one frame's GPU time, true if the scale changed
+    bool update(double gpuMilliseconds)
+    {
+        //Scale down to this fraction of the target so small spikes don't push it straight back over, don't scale up below LOW
+        const double HEADROOM = 0.9;
+        const double LOW = 0.75;
+        const double SMOOTHING = 0.1;
+        if (settleFrames > 0)
+        {
+            settleFrames--;
+            return false;
+        }
+        average = samples == 0 ? gpuMilliseconds : average + (gpuMilliseconds - average) * SMOOTHING;
+        if (++samples < MIN_SAMPLES)
+            return false;
+        if (average <= targetMilliseconds && (average >= targetMilliseconds * LOW || scale >= maxScale))
+            return false;
+        float ideal = scale * (float)std::sqrt(targetMilliseconds * HEADROOM / std::max(average, 0.001));
+        //At most two steps per change
+        float wanted = std::round(ideal / step) * step;
+        wanted = std::min(std::max(wanted, scale - 2.0f * step), scale + 2.0f * step);
+        wanted = std::min(std::max(wanted, minScale), maxScale);
+        if (std::fabs(wanted - scale) < step * 0.5f)
+            return false;
+        scale = wanted;
+        reset();
+        return true;
+    }
+
+    //Forget the measurements, for when something other than the scale changed the frame's cost
+    void reset()
+    {
+        samples = 0;
+        settleFrames = GpuFrameTimer::LATENCY;
+    }
+
+    //Render size for an output size at the current scale, never 0
+    int scaled(int size) const
+    {
+        return std::max(1, (int)(size * scale + 0.5f));
+    }
+
+private:
+    double average = 0.0;
+    unsigned int samples = 0;
+    unsigned int settleFrames = 0;
+};
+
+//Stretches the rendered corner of a scene target over the output with fullscreen.vs/upscale.fs, bilinear plus a light sharpen.
+//At full scale it's a straight blit
+class UpscalePass
+{
+public:
+    Shader shader;
+    //Sharpen strength while upscaling, 0 is plain bilinear
+    float sharpness = 0.5f;
+
+    UpscalePass() : shader("fullscreen.vs", "upscale.fs")
+    {
+        uvScaleUniform = shader.uniform("uvScale");
+        outputSizeUniform = shader.uniform("outputSize");
+        sharpnessUniform = shader.uniform("sharpness");
+        glUseProgram(shader.shaderProgram);
+        shader.setInt("scene", 0);
+        glUseProgram(0);
+    }
+
+    //Draw the renderWidth x renderHeight corner of source into outputFramebuffer, which is left bound with a full viewport
+    void draw(RenderState& state, const RenderTarget& source, int renderWidth, int renderHeight, unsigned int outputFramebuffer, int outputWidth, int outputHeight)
+    {
+        if (renderWidth == outputWidth && renderHeight == outputHeight)
+        {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, source.framebuffer);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFramebuffer);
+            glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, outputWidth, outputHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+            glViewport(0, 0, outputWidth, outputHeight);
+            return;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+        glViewport(0, 0, outputWidth, outputHeight);
+        state.setEnabled(GL_DEPTH_TEST, false);
+        state.setEnabled(GL_BLEND, false);
+        state.colorMask(true);
+        state.useProgram(shader.shaderProgram);
+        state.bindTexture(0, source.colorTexture);
+        shader.setVec2(uvScaleUniform, glm::vec2((float)renderWidth / source.width, (float)renderHeight / source.height));
+        shader.setVec2(outputSizeUniform, glm::vec2((float)outputWidth, (float)outputHeight));
+        shader.setFloat(sharpnessUniform, sharpness);
+        triangle.draw(state);
+    }
+
+    void destroy()
+    {
+        triangle.destroy();
+        glDeleteProgram(shader.shaderProgram);
+    }
+
+private:
+    FullScreenTriangle triangle;
+    UniformHandle uvScaleUniform;
+    UniformHandle outputSizeUniform;
+    UniformHandle sharpnessUniform;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef FRAME_PACING_H
+#define FRAME_PACING_H
+
+#include <glad/glad.h>
+#include "gpu_query_ring.h"
+
+#include <chrono>
+#include <thread>
+#include <cmath>
+
+//Fixed rate simulation clock. Real time goes in each frame and comes out as whole steps, so movement and animation don't
+//depend on the frame rate. The leftover fraction of a step is what rendering interpolates by
+class FixedTimestep
+{
+public:
+    double step;
+    //Steps run in one frame at most, the rest of a long hitch is dropped so a slow frame can't snowball into slower ones
+    unsigned int maxSteps;
+    //Simulated time after the last step
+    double time = 0.0;
+
+    FixedTimestep(double newStep = 1.0 / 120.0, unsigned int newMaxSteps = 8) : step(newStep), maxSteps(newMaxSteps)
+    {
+    }
+
+    //Add elapsed real seconds, returns how many steps to run now
+    unsigned int advance(double elapsed)
+    {
+        accumulator += elapsed;
+        unsigned int steps = (unsigned int)(accumulator / step);
+        if (steps > maxSteps)
+            steps = maxSteps;
+        accumulator -= steps * step;
+        if (accumulator >= step)
+            accumulator = std::fmod(accumulator, step);
+        time += steps * step;
+        return steps;
+    }
+
+    //How far between the second to last and the last step rendering is, 0 to 1
+    double alpha() const
+    {
+        return accumulator / step;
+    }
+
+    //Simulated time to render at, between the last two steps
+    double interpolatedTime() const
+    {
+        return time - step + accumulator;
+    }
+
+private:
+    double accumulator = 0.0;
+};
+
+//Holds frames to a target rate. Most of the wait is slept and the last stretch spun, since sleeps overshoot by anything from
+//a few microseconds to a whole scheduler tick. The worst overshoot seen so far decides how long that stretch is, so coarse timers
+//cost spinning rather than missed frames. Deadlines advance by whole periods to keep the average on target
+class FrameLimiter
+{
+public:
+    //Frames per second, 0 or less doesn't limit
+    double targetFps = 0.0;
+    //Time spent waiting, for the report
+    double waitMilliseconds = 0.0;
+
+    void wait()
+    {
+        typedef std::chrono::steady_clock Clock;
+        if (targetFps <= 0.0)
+        {
+            started = false;
+            return;
+        }
+        Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFps));
+        Clock::time_point start = Clock::now();
+        //First frame, or more than a frame late, start over instead of rushing to catch up
+        if (!started || start > deadline + period)
+        {
+            deadline = start;
+            started = true;
+        }
+        Clock::time_point now = start;
+        while (deadline - now > spin + std::chrono::milliseconds(1))
+        {
+            Clock::time_point sleepStart = now;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            now = Clock::now();
+            Clock::duration overshoot = now - sleepStart - std::chrono::milliseconds(1);
+            if (overshoot > spin)
+                spin = overshoot;
+        }
+        while (now < deadline)
+        {
+            std::this_thread::yield();
+            now = Clock::now();
+        }
+        deadline += period;
+        waitMilliseconds += std::chrono::duration<double, std::milli>(now - start).count();
+    }
+
+private:
+    bool started = false;
+    std::chrono::steady_clock::time_point deadline;
+    std::chrono::steady_clock::duration spin = std::chrono::microseconds(500);
+};
+
+//Input to present latency. The GPU clock is read when input is sampled and a GL_TIMESTAMP query goes in right after the swap,
+//so the difference is how long that input took to reach a finished frame. Compositor time after that isn't seen, so this is a
+//lower bound. Read back LATENCY - 1 frames later like GpuFrameTimer
+class LatencyTimer : public GpuQueryRing<GL_TIMESTAMP>
+{
+public:
+    //GPU clock now, in nanoseconds. Doesn't wait for queued work
+    static GLint64 now()
+    {
+        GLint64 timestamp = 0;
+        glGetInteger64v(GL_TIMESTAMP, &timestamp);
+        return timestamp;
+    }
+    //Right after the swap, inputTimestamp is now() from when the frame's input was read
+    void end(unsigned int frame, GLint64 inputTimestamp)
+    {
+        stamp(frame);
+        inputTimestamps[frame % LATENCY] = inputTimestamp;
+    }
+    //Milliseconds for the frame presented LATENCY - 1 frames ago, false if there isn't one yet or it isn't ready
+    bool collect(unsigned int frame, double& milliseconds)
+    {
+        GLuint64 presented = 0;
+        if (!GpuQueryRing::collect(frame, presented))
+            return false;
+        milliseconds = ((GLint64)presented - inputTimestamps[collectSlot(frame)]) / 1000000.0;
+        return true;
+    }
+
+private:
+    GLint64 inputTimestamps[LATENCY] = {};
+};
+
+#endif
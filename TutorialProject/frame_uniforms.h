@@ -0,0 +1,63 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "stream_buffer.h"
+
+#include <cstring>
+
+//Binding point shared by every shader that reads the FrameData block
+const unsigned int FRAME_UNIFORMS_BINDING = 0;
+
+//The FrameData block, passed to Shader as its prelude so every program using it declares the same thing. Keep in step with FrameUniforms
+const char* const FRAME_DATA_GLSL =
+    "layout (std140) uniform FrameData\n"
+    "{\n"
+    "    mat4 view;\n"
+    "    mat4 projection;\n"
+    "    mat4 viewProjection;\n"
+    "    vec4 cameraPosition;\n"
+    "    vec4 lightPosition;\n"
+    "    vec4 lightColor;\n"
+    "    vec4 lightStrengths;\n"
+    "    vec4 clusterGrid;\n"
+    "    vec4 clusterDepth;\n"
+    "    vec4 lightOffsets;\n"
+    "};\n";
+
+//Mirrors the std140 FrameData block of FRAME_DATA_GLSL, only mat4/vec4 members so no extra padding rules apply
+struct FrameUniforms
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec4 cameraPosition;
+    glm::vec4 lightPosition;
+    glm::vec4 lightColor;
+    //x = ambient strength, y = specular strength
+    glm::vec4 lightStrengths;
+    //Clustered lights, see LightGrid. x, y, z = clusters along each axis, w = light count
+    glm::vec4 clusterGrid;
+    //x = near plane, y = LightGrid::depthScale
+    glm::vec4 clusterDepth;
+    //Texel offsets into the light grid buffer texture: x = lights, y = clusters, z = light indices
+    glm::vec4 lightOffsets;
+};
+
+//Copy this frame's data into the stream buffer and point FRAME_UNIFORMS_BINDING at it, every shader bound there sees it
+inline bool uploadFrameUniforms(StreamBuffer& stream, const FrameUniforms& data)
+{
+    static int alignment = 0;
+    if (alignment == 0)
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    StreamAllocation allocation = stream.allocate(sizeof(FrameUniforms), (size_t)alignment);
+    if (allocation.data == nullptr)
+        return false;
+    std::memcpy(allocation.data, &data, sizeof(FrameUniforms));
+    stream.commit(allocation);
+    glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, stream.buffer, (GLintptr)allocation.offset, sizeof(FrameUniforms));
+    return true;
+}
+
+#endif
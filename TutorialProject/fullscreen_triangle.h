@@ -0,0 +1,37 @@
+#ifndef FULLSCREEN_TRIANGLE_H
+#define FULLSCREEN_TRIANGLE_H
+
+#include <glad/glad.h>
+#include "render_state.h"
+
+//Draw call for the triangle fullscreen.vs builds from gl_VertexID, shared by every full screen pass. Use it with a program
+//whose vertex stage is fullscreen.vs
+class FullScreenTriangle
+{
+public:
+    FullScreenTriangle()
+    {
+        //Core profile needs a VAO bound to draw, even one with no attributes
+        glGenVertexArrays(1, &emptyVAO);
+    }
+    FullScreenTriangle(const FullScreenTriangle&) = delete;
+    FullScreenTriangle& operator=(const FullScreenTriangle&) = delete;
+
+    //Covers the current viewport
+    void draw(RenderState& state)
+    {
+        state.bindVertexArray(emptyVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+
+    void destroy()
+    {
+        glDeleteVertexArrays(1, &emptyVAO);
+        emptyVAO = 0;
+    }
+
+private:
+    unsigned int emptyVAO = 0;
+};
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+//Extension list of the current context, read once on first use. Call on the GL thread after GLAD is loaded
+inline bool hasGLExtension(const char* name)
+{
+    static std::vector<std::string> extensions;
+    static bool queried = false;
+    if (!queried)
+    {
+        int count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (int i = 0; i < count; i++)
+            extensions.push_back((const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i));
+        std::sort(extensions.begin(), extensions.end());
+        queried = true;
+    }
+    return std::binary_search(extensions.begin(), extensions.end(), std::string(name));
+}
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+//glBufferStorage (GL 4.4 / GL_ARB_buffer_storage) isn't part of the 3.3 core loader, so it's resolved by hand
+typedef void (APIENTRY* BufferStorageFunction)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+//Program binaries (GL 4.1 / GL_ARB_get_program_binary) and parallel shader compiles (GL_KHR_parallel_shader_compile), same story
+typedef void (APIENTRY* GetProgramBinaryFunction)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRY* ProgramBinaryFunction)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRY* ProgramParameteriFunction)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRY* MaxShaderCompilerThreadsFunction)(GLuint count);
+
+//Base instance draws (GL 4.2 / GL_ARB_base_instance) and multi-draw indirect (GL 4.3 / GL_ARB_multi_draw_indirect)
+typedef void (APIENTRY* DrawElementsInstancedBaseVertexBaseInstanceFunction)(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instanceCount, GLint baseVertex, GLuint baseInstance);
+typedef void (APIENTRY* MultiDrawElementsIndirectFunction)(GLenum mode, GLenum type, const void* indirect, GLsizei drawCount, GLsizei stride);
+
+//Each is null until loadGLExtensionFunctions finds it
+inline BufferStorageFunction& bufferStorageFunction()
+{
+    static BufferStorageFunction function = nullptr;
+    return function;
+}
+inline GetProgramBinaryFunction& getProgramBinaryFunction()
+{
+    static GetProgramBinaryFunction function = nullptr;
+    return function;
+}
+inline ProgramBinaryFunction& programBinaryFunction()
+{
+    static ProgramBinaryFunction function = nullptr;
+    return function;
+}
+inline ProgramParameteriFunction& programParameteriFunction()
+{
+    static ProgramParameteriFunction function = nullptr;
+    return function;
+}
+inline DrawElementsInstancedBaseVertexBaseInstanceFunction& drawElementsBaseInstanceFunction()
+{
+    static DrawElementsInstancedBaseVertexBaseInstanceFunction function = nullptr;
+    return function;
+}
+inline MultiDrawElementsIndirectFunction& multiDrawElementsIndirectFunction()
+{
+    static MultiDrawElementsIndirectFunction function = nullptr;
+    return function;
+}
+//True once the driver has been told to compile on its own threads
+inline bool& parallelShaderCompile()
+{
+    static bool enabled = false;
+    return enabled;
+}
+
+//Resolve the optional entry points above, call once after GLAD is loaded
+inline void loadGLExtensionFunctions(GLADloadproc load)
+{
+    if (hasGLExtension("GL_ARB_buffer_storage"))
+        bufferStorageFunction() = (BufferStorageFunction)load("glBufferStorage");
+    //Binaries are only useful if the driver offers at least one format to save them in
+    int binaryFormats = 0;
+    if (hasGLExtension("GL_ARB_get_program_binary"))
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+    if (binaryFormats > 0)
+    {
+        getProgramBinaryFunction() = (GetProgramBinaryFunction)load("glGetProgramBinary");
+        programBinaryFunction() = (ProgramBinaryFunction)load("glProgramBinary");
+        programParameteriFunction() = (ProgramParameteriFunction)load("glProgramParameteri");
+    }
+    //Indirect commands only honour a non-zero base instance with GL_ARB_base_instance, so multi-draw needs it as well
+    if (hasGLExtension("GL_ARB_base_instance"))
+        drawElementsBaseInstanceFunction() = (DrawElementsInstancedBaseVertexBaseInstanceFunction)load("glDrawElementsInstancedBaseVertexBaseInstance");
+    if (drawElementsBaseInstanceFunction() && hasGLExtension("GL_ARB_draw_indirect") && hasGLExtension("GL_ARB_multi_draw_indirect"))
+        multiDrawElementsIndirectFunction() = (MultiDrawElementsIndirectFunction)load("glMultiDrawElementsIndirect");
+    MaxShaderCompilerThreadsFunction maxCompilerThreads = nullptr;
+    if (hasGLExtension("GL_KHR_parallel_shader_compile"))
+        maxCompilerThreads = (MaxShaderCompilerThreadsFunction)load("glMaxShaderCompilerThreadsKHR");
+    else if (hasGLExtension("GL_ARB_parallel_shader_compile"))
+        maxCompilerThreads = (MaxShaderCompilerThreadsFunction)load("glMaxShaderCompilerThreadsARB");
+    if (maxCompilerThreads)
+    {
+        //Let the driver pick how many threads
+        maxCompilerThreads(0xFFFFFFFFu);
+        parallelShaderCompile() = true;
+    }
+}
+
+#endif
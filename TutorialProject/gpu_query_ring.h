@@ -0,0 +1,52 @@
+#ifndef GPU_QUERY_RING_H
+#define GPU_QUERY_RING_H
+
+#include <glad/glad.h>
+
+//One query of TARGET per frame in a small ring, each result is read a few frames after it was issued so the CPU never waits on it.
+//Range targets (GL_TIME_ELAPSED, GL_SAMPLES_PASSED) go through begin/end, GL_TIMESTAMP through stamp
+template <GLenum TARGET>
+class GpuQueryRing
+{
+public:
+    static const unsigned int LATENCY = 4;
+
+    GpuQueryRing()
+    {
+        glGenQueries(LATENCY, queries);
+    }
+    void begin(unsigned int frame)
+    {
+        glBeginQuery(TARGET, queries[frame % LATENCY]);
+    }
+    void end()
+    {
+        glEndQuery(TARGET);
+    }
+    //GPU clock once everything before it has finished
+    void stamp(unsigned int frame)
+    {
+        glQueryCounter(queries[frame % LATENCY], TARGET);
+    }
+    //Ring slot collect() reads on this frame
+    static unsigned int collectSlot(unsigned int frame)
+    {
+        return (frame + 1) % LATENCY;
+    }
+    //Raw result of the query issued LATENCY - 1 frames ago, false if there isn't one yet or it isn't ready
+    bool collect(unsigned int frame, GLuint64& result)
+    {
+        if (frame + 1 < LATENCY)
+            return false;
+        unsigned int query = queries[collectSlot(frame)];
+        int available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return false;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &result);
+        return true;
+    }
+    unsigned int queries[LATENCY];
+};
+
+#endif
@@ -0,0 +1,19 @@
+#version 330 core
+//One Hi-Z reduction step: each output texel keeps the farthest depth of the 2x2 source texels under it.
+//Sizes round up, so on odd sized sources the last texel of a row or column is read twice instead of skipped
+out float farthest;
+
+uniform sampler2D source;
+//Part of source written this frame, past it is whatever a frame at a larger render scale left
+uniform vec2 sourceSize;
+
+void main()
+{
+    ivec2 last = ivec2(sourceSize) - 1;
+    ivec2 base = ivec2(gl_FragCoord.xy) * 2;
+    float depth = texelFetch(source, min(base, last), 0).r;
+    depth = max(depth, texelFetch(source, min(base + ivec2(1, 0), last), 0).r);
+    depth = max(depth, texelFetch(source, min(base + ivec2(0, 1), last), 0).r);
+    depth = max(depth, texelFetch(source, min(base + ivec2(1, 1), last), 0).r);
+    farthest = depth;
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#ifndef INDIRECT_DRAW_H
+#define INDIRECT_DRAW_H
+
+#include <glad/glad.h>
+#include "gl_extensions.h"
+#include "mesh.h"
+
+#include <vector>
+
+//Layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+//One frame's draws of pooled meshes as indirect commands. Each command's instances start at its base instance in the instance
+//attributes, which is how per draw data gets to the vertex shader without gl_DrawID. With multi-draw indirect the whole list
+//is one call, with only base instance draws it's one call per command. A plain 3.3 context has neither (see available())
+class IndirectDrawList
+{
+public:
+    std::vector<DrawElementsIndirectCommand> commands;
+
+    static bool available()
+    {
+        return drawElementsBaseInstanceFunction() != nullptr;
+    }
+    static bool multiDraw()
+    {
+        return multiDrawElementsIndirectFunction() != nullptr;
+    }
+
+    void clear()
+    {
+        commands.clear();
+    }
+
+    //instanceCount instances of a level of a mesh from a MeshPool, reading instances from baseInstance on
+    void add(const MeshLod& lod, GLenum indexType, unsigned int instanceCount, unsigned int baseInstance)
+    {
+        if (instanceCount == 0 || lod.indexCount == 0)
+            return;
+        DrawElementsIndirectCommand command;
+        command.count = (GLuint)lod.indexCount;
+        command.instanceCount = instanceCount;
+        command.firstIndex = (GLuint)(lod.indexOffset / indexSize(indexType));
+        command.baseVertex = 0;
+        command.baseInstance = baseInstance;
+        commands.push_back(command);
+    }
+
+    size_t bytes() const
+    {
+        return commands.size() * sizeof(DrawElementsIndirectCommand);
+    }
+
+    unsigned long long triangles() const
+    {
+        unsigned long long total = 0;
+        for (const DrawElementsIndirectCommand& command : commands)
+            total += (unsigned long long)command.count / 3 * command.instanceCount;
+        return total;
+    }
+
+    //Issue every command against the bound VAO, returns the GL draw calls made. For multi-draw the commands have to be copied to
+    //commandOffset in the buffer bound to GL_DRAW_INDIRECT_BUFFER
+    unsigned int draw(GLenum indexType, size_t commandOffset) const
+    {
+        if (commands.empty())
+            return 0;
+        if (multiDraw())
+        {
+            multiDrawElementsIndirectFunction()(GL_TRIANGLES, indexType, (const void*)commandOffset, (GLsizei)commands.size(), 0);
+            return 1;
+        }
+        size_t size = indexSize(indexType);
+        for (const DrawElementsIndirectCommand& command : commands)
+        {
+            drawElementsBaseInstanceFunction()(GL_TRIANGLES, (GLsizei)command.count, indexType, (const void*)(command.firstIndex * size),
+                (GLsizei)command.instanceCount, command.baseVertex, command.baseInstance);
+        }
+        return (unsigned int)commands.size();
+    }
+
+private:
+    static size_t indexSize(GLenum indexType)
+    {
+        return indexType == GL_UNSIGNED_BYTE ? 1 : indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+    }
+};
+
+#endif
@@ -0,0 +1,299 @@
+#ifndef JSON_READER_H
+#define JSON_READER_H
+
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+//Parsed JSON document. Objects keep their keys and values in two matching vectors, lookups are linear since the documents
+//read here (glTF headers) have small objects. Missing members and out of range elements come back as null
+struct JsonValue
+{
+    enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+    Type type = NUL;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    //Array elements, or object values
+    std::vector<JsonValue> elements;
+    //Object keys, one per element
+    std::vector<std::string> keys;
+
+    const JsonValue& operator[](const char* key) const
+    {
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            if (keys[i] == key)
+                return elements[i];
+        }
+        return null();
+    }
+    const JsonValue& operator[](size_t index) const
+    {
+        return index < elements.size() && type == ARRAY ? elements[index] : null();
+    }
+    bool has(const char* key) const
+    {
+        return (*this)[key].type != NUL;
+    }
+    size_t size() const
+    {
+        return elements.size();
+    }
+    double numberOr(double fallback) const
+    {
+        return type == NUMBER ? number : fallback;
+    }
+    bool booleanOr(bool fallback) const
+    {
+        return type == BOOLEAN ? boolean : fallback;
+    }
+
+private:
+    static const JsonValue& null()
+    {
+        static const JsonValue value;
+        return value;
+    }
+};
+
+//Recursive descent parser over [begin, end), which doesn't have to be null terminated
+class JsonReader
+{
+public:
+    //Nesting deeper than this is rejected rather than risking the stack
+    static const unsigned int MAX_DEPTH = 64;
+
+    //Parse one document, false with the byte offset of the problem in errorOffset if it isn't valid JSON
+    bool parse(const char* begin, const char* end, JsonValue& document)
+    {
+        start = begin;
+        p = begin;
+        last = end;
+        errorOffset = 0;
+        if (!parseValue(document, 0))
+        {
+            errorOffset = (size_t)(p - start);
+            return false;
+        }
+        skipWhitespace();
+        //Trailing padding (glTF pads its JSON chunk with spaces) is whitespace, anything else is an error
+        if (p != last)
+        {
+            errorOffset = (size_t)(p - start);
+            return false;
+        }
+        return true;
+    }
+
+    size_t errorOffset = 0;
+
+private:
+    const char* start = nullptr;
+    const char* p = nullptr;
+    const char* last = nullptr;
+
+    void skipWhitespace()
+    {
+        while (p < last && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+            p++;
+    }
+
+    bool literal(const char* word)
+    {
+        size_t length = std::strlen(word);
+        if ((size_t)(last - p) < length || std::memcmp(p, word, length) != 0)
+            return false;
+        p += length;
+        return true;
+    }
+
+    bool parseValue(JsonValue& value, unsigned int depth)
+    {
+        skipWhitespace();
+        if (p >= last || depth > MAX_DEPTH)
+            return false;
+        switch (*p)
+        {
+        case '{':
+            return parseObject(value, depth);
+        case '[':
+            return parseArray(value, depth);
+        case '"':
+            value.type = JsonValue::STRING;
+            return parseString(value.string);
+        case 't':
+            value.type = JsonValue::BOOLEAN;
+            value.boolean = true;
+            return literal("true");
+        case 'f':
+            value.type = JsonValue::BOOLEAN;
+            value.boolean = false;
+            return literal("false");
+        case 'n':
+            value.type = JsonValue::NUL;
+            return literal("null");
+        default:
+            value.type = JsonValue::NUMBER;
+            return parseNumber(value.number);
+        }
+    }
+
+    bool parseObject(JsonValue& value, unsigned int depth)
+    {
+        value.type = JsonValue::OBJECT;
+        p++;
+        skipWhitespace();
+        if (p < last && *p == '}')
+        {
+            p++;
+            return true;
+        }
+        while (true)
+        {
+            skipWhitespace();
+            std::string key;
+            if (p >= last || *p != '"' || !parseString(key))
+                return false;
+            skipWhitespace();
+            if (p >= last || *p != ':')
+                return false;
+            p++;
+            value.keys.push_back(key);
+            value.elements.emplace_back();
+            if (!parseValue(value.elements.back(), depth + 1))
+                return false;
+            skipWhitespace();
+            if (p < last && *p == ',')
+            {
+                p++;
+                continue;
+            }
+            if (p < last && *p == '}')
+            {
+                p++;
+                return true;
+            }
+            return false;
+        }
+    }
+
+    bool parseArray(JsonValue& value, unsigned int depth)
+    {
+        value.type = JsonValue::ARRAY;
+        p++;
+        skipWhitespace();
+        if (p < last && *p == ']')
+        {
+            p++;
+            return true;
+        }
+        while (true)
+        {
+            value.elements.emplace_back();
+            if (!parseValue(value.elements.back(), depth + 1))
+                return false;
+            skipWhitespace();
+            if (p < last && *p == ',')
+            {
+                p++;
+                continue;
+            }
+            if (p < last && *p == ']')
+            {
+                p++;
+                return true;
+            }
+            return false;
+        }
+    }
+
+    bool parseString(std::string& result)
+    {
+        p++;
+        while (p < last && *p != '"')
+        {
+            if (*p != '\\')
+            {
+                result += *p++;
+                continue;
+            }
+            if (++p >= last)
+                return false;
+            char escape = *p++;
+            switch (escape)
+            {
+            case '"': result += '"'; break;
+            case '\\': result += '\\'; break;
+            case '/': result += '/'; break;
+            case 'b': result += '\b'; break;
+            case 'f': result += '\f'; break;
+            case 'n': result += '\n'; break;
+            case 'r': result += '\r'; break;
+            case 't': result += '\t'; break;
+            case 'u':
+            {
+                if (last - p < 4)
+                    return false;
+                unsigned int code = 0;
+                for (unsigned int i = 0; i < 4; i++)
+                {
+                    char digit = *p++;
+                    code <<= 4;
+                    if (digit >= '0' && digit <= '9')
+                        code |= digit - '0';
+                    else if (digit >= 'a' && digit <= 'f')
+                        code |= digit - 'a' + 10;
+                    else if (digit >= 'A' && digit <= 'F')
+                        code |= digit - 'A' + 10;
+                    else
+                        return false;
+                }
+                //UTF-8, surrogate pairs are kept as two separate code points
+                if (code < 0x80)
+                    result += (char)code;
+                else if (code < 0x800)
+                {
+                    result += (char)(0xC0 | (code >> 6));
+                    result += (char)(0x80 | (code & 0x3F));
+                }
+                else
+                {
+                    result += (char)(0xE0 | (code >> 12));
+                    result += (char)(0x80 | ((code >> 6) & 0x3F));
+                    result += (char)(0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        if (p >= last)
+            return false;
+        p++;
+        return true;
+    }
+
+    bool parseNumber(double& number)
+    {
+        //strtod needs a terminator, numbers are short so copy just this one out
+        char buffer[64];
+        size_t length = 0;
+        while (p + length < last && length + 1 < sizeof(buffer) && p[length] != '\0' && std::strchr("+-0123456789.eE", p[length]) != NULL)
+            length++;
+        if (length == 0)
+            return false;
+        std::memcpy(buffer, p, length);
+        buffer[length] = '\0';
+        char* parsedEnd;
+        number = std::strtod(buffer, &parsedEnd);
+        if (parsedEnd != buffer + length)
+            return false;
+        p += length;
+        return true;
+    }
+};
+
+#endif
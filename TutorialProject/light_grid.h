@@ -0,0 +1,229 @@
+#ifndef LIGHT_GRID_H
+#define LIGHT_GRID_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "stream_buffer.h"
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <cfloat>
+
+//Point light in world space, lights nothing past radius
+struct PointLight
+{
+    glm::vec3 position;
+    float radius;
+    glm::vec3 color;
+};
+
+//One RGBA32UI texel of the light grid buffer texture, floats are stored as their bits
+struct LightTexel
+{
+    std::uint32_t x, y, z, w;
+};
+
+//Lights, and for each cluster the list of lights reaching it. Clusters split the view into CLUSTERS_X x CLUSTERS_Y screen tiles
+//and CLUSTERS_Z depth slices, exponentially spaced so near slices stay thin. Built on the CPU from each light's bounding box,
+//so a fragment only loops over the lights of its own cluster. shader.fs has the matching lookup
+class LightGrid
+{
+public:
+    static const unsigned int CLUSTERS_X = 16;
+    static const unsigned int CLUSTERS_Y = 8;
+    static const unsigned int CLUSTERS_Z = 24;
+    static const unsigned int CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+    static const unsigned int MAX_LIGHTS = 1024;
+    //Light index slots shared by all clusters, assignments past this are dropped
+    static const unsigned int MAX_LIGHT_INDICES = 65536;
+    //Most texels one frame can need, lights take two texels, clusters one and indices a quarter each
+    static const unsigned int MAX_TEXELS = MAX_LIGHTS * 2 + CLUSTER_COUNT + MAX_LIGHT_INDICES / 4;
+
+    //Packed for upload: lights from lightsTexel, one (first index, count) texel per cluster from clustersTexel, then the indices four per texel
+    std::vector<LightTexel> texels;
+    unsigned int lightsTexel = 0;
+    unsigned int clustersTexel = 0;
+    unsigned int indicesTexel = 0;
+    unsigned int lightCount = 0;
+    unsigned int indexCount = 0;
+    unsigned int droppedIndices = 0;
+
+    //Exponential slice spacing, slice = log(depth / near) * depthScale
+    static float depthScale(float nearPlane, float farPlane)
+    {
+        return CLUSTERS_Z / std::log(farPlane / nearPlane);
+    }
+
+    void build(const std::vector<PointLight>& lights, const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane)
+    {
+        lightCount = (unsigned int)std::min(lights.size(), (size_t)MAX_LIGHTS);
+        indexCount = 0;
+        droppedIndices = 0;
+        float scale = depthScale(nearPlane, farPlane);
+
+        //Count pass, remembering the cluster range of each light for the fill pass
+        ranges.resize(lightCount);
+        counts.assign(CLUSTER_COUNT, 0);
+        for (unsigned int i = 0; i < lightCount; i++)
+        {
+            ranges[i] = clusterRange(lights[i], view, projection, nearPlane, farPlane, scale);
+            forEachCluster(ranges[i], [this](unsigned int cluster) { counts[cluster]++; });
+        }
+        firsts.resize(CLUSTER_COUNT);
+        unsigned int total = 0;
+        for (unsigned int cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+        {
+            firsts[cluster] = total;
+            total += counts[cluster];
+        }
+        indexCount = total < MAX_LIGHT_INDICES ? total : MAX_LIGHT_INDICES;
+        droppedIndices = total - indexCount;
+
+        lightsTexel = 0;
+        clustersTexel = lightCount * 2;
+        indicesTexel = clustersTexel + CLUSTER_COUNT;
+        texels.assign(indicesTexel + (indexCount + 3) / 4, LightTexel{ 0, 0, 0, 0 });
+        for (unsigned int i = 0; i < lightCount; i++)
+        {
+            texels[lightsTexel + i * 2] = floatTexel(lights[i].position.x, lights[i].position.y, lights[i].position.z, lights[i].radius);
+            texels[lightsTexel + i * 2 + 1] = floatTexel(lights[i].color.x, lights[i].color.y, lights[i].color.z, 0.0f);
+        }
+        //Fill pass, counts are rebuilt as each cluster's list grows
+        std::uint32_t* indices = (std::uint32_t*)(texels.data() + indicesTexel);
+        std::fill(counts.begin(), counts.end(), 0u);
+        for (unsigned int i = 0; i < lightCount; i++)
+        {
+            forEachCluster(ranges[i], [this, i, indices](unsigned int cluster) {
+                unsigned int slot = firsts[cluster] + counts[cluster];
+                if (slot >= MAX_LIGHT_INDICES)
+                    return;
+                indices[slot] = i;
+                counts[cluster]++;
+            });
+        }
+        for (unsigned int cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+            texels[clustersTexel + cluster] = LightTexel{ firsts[cluster], counts[cluster], 0, 0 };
+    }
+
+private:
+    //Inclusive cluster box a light touches, empty when min > max
+    struct ClusterRange
+    {
+        int minX, minY, minZ;
+        int maxX, maxY, maxZ;
+    };
+    std::vector<ClusterRange> ranges;
+    std::vector<std::uint32_t> counts;
+    std::vector<std::uint32_t> firsts;
+
+    static LightTexel floatTexel(float x, float y, float z, float w)
+    {
+        LightTexel texel;
+        std::memcpy(&texel.x, &x, sizeof(float));
+        std::memcpy(&texel.y, &y, sizeof(float));
+        std::memcpy(&texel.z, &z, sizeof(float));
+        std::memcpy(&texel.w, &w, sizeof(float));
+        return texel;
+    }
+
+    template <typename Visit>
+    static void forEachCluster(const ClusterRange& range, Visit visit)
+    {
+        for (int z = range.minZ; z <= range.maxZ; z++)
+            for (int y = range.minY; y <= range.maxY; y++)
+                for (int x = range.minX; x <= range.maxX; x++)
+                    visit((unsigned int)(x + (int)CLUSTERS_X * (y + (int)CLUSTERS_Y * z)));
+    }
+
+    //Clusters overlapped by the light's view space bounding box. x / depth is monotonic over the box, so its projected
+    //corners bound it on screen. The near side is clamped to the near plane so boxes through the camera stay finite
+    static ClusterRange clusterRange(const PointLight& light, const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane, float scale)
+    {
+        ClusterRange range = { 0, 0, 0, -1, -1, -1 };
+        glm::vec4 center = view * glm::vec4(light.position, 1.0f);
+        float depth = -center.z;
+        float closest = std::max(depth - light.radius, nearPlane);
+        float farthest = std::min(depth + light.radius, farPlane);
+        if (closest > farthest)
+            return range;
+        float minX = FLT_MAX, maxX = -FLT_MAX, minY = FLT_MAX, maxY = -FLT_MAX;
+        float depths[2] = { closest, farthest };
+        for (float d : depths)
+        {
+            for (int side = -1; side <= 1; side += 2)
+            {
+                float x = projection[0][0] * (center.x + side * light.radius) / d;
+                float y = projection[1][1] * (center.y + side * light.radius) / d;
+                minX = std::min(minX, x);
+                maxX = std::max(maxX, x);
+                minY = std::min(minY, y);
+                maxY = std::max(maxY, y);
+            }
+        }
+        if (minX > 1.0f || maxX < -1.0f || minY > 1.0f || maxY < -1.0f)
+            return range;
+        range.minX = tile(minX, CLUSTERS_X);
+        range.maxX = tile(maxX, CLUSTERS_X);
+        range.minY = tile(minY, CLUSTERS_Y);
+        range.maxY = tile(maxY, CLUSTERS_Y);
+        range.minZ = slice(closest, nearPlane, scale);
+        range.maxZ = slice(farthest, nearPlane, scale);
+        return range;
+    }
+
+    static int tile(float ndc, unsigned int tiles)
+    {
+        int index = (int)std::floor((ndc * 0.5f + 0.5f) * tiles);
+        return std::min(std::max(index, 0), (int)tiles - 1);
+    }
+
+    static int slice(float depth, float nearPlane, float scale)
+    {
+        int index = (int)std::floor(std::log(depth / nearPlane) * scale);
+        return std::min(std::max(index, 0), (int)CLUSTERS_Z - 1);
+    }
+};
+
+//GPU side of the grid: a fenced stream ring (see StreamBuffer) viewed as one RGBA32UI buffer texture. Each frame's texels
+//land at a different offset, shaders add the base texel returned by upload to every lookup
+class LightGridBuffer
+{
+public:
+    StreamBuffer stream;
+    unsigned int texture = 0;
+
+    bool create()
+    {
+        if (!stream.create(LightGrid::MAX_TEXELS * sizeof(LightTexel)))
+            return false;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32UI, stream.buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        return true;
+    }
+
+    void destroy()
+    {
+        glDeleteTextures(1, &texture);
+        texture = 0;
+        stream.destroy();
+    }
+
+    //Copy the grid into this frame's region, false if it doesn't fit. baseTexel is where it starts in the buffer texture
+    bool upload(const LightGrid& grid, unsigned int& baseTexel)
+    {
+        StreamAllocation allocation = stream.allocate(grid.texels.size() * sizeof(LightTexel), sizeof(LightTexel));
+        if (allocation.data == nullptr)
+            return false;
+        std::memcpy(allocation.data, grid.texels.data(), allocation.size);
+        stream.commit(allocation);
+        baseTexel = (unsigned int)(allocation.offset / sizeof(LightTexel));
+        return true;
+    }
+};
+
+#endif
@@ -1,8 +1,11 @@
 #version 330 core
 out vec4 FragColor;
 
-uniform vec3 lightColor;
+in vec3 lightCubeColor;
+
+//FrameData (camera and light data, written once per frame by main()) is inserted by Shader, see FRAME_DATA_GLSL
+
 void main()
 {
-    FragColor = vec4(lightColor, 1.0);
+    FragColor = vec4(lightCubeColor, 1.0);
 }
\ No newline at end of file
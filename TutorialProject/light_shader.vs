@@ -1,11 +1,15 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
+//Model matrix and color of each light, streamed per frame
+layout (location = 4) in mat4 aInstanceModel;
+layout (location = 8) in vec4 aInstanceColor;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+out vec3 lightCubeColor;
+
+//FrameData (camera and light data, written once per frame by main()) is inserted by Shader, see FRAME_DATA_GLSL
 
 void main()
 {
-	gl_Position = projection * view* model * vec4(aPos, 1.0);
+	gl_Position = viewProjection * aInstanceModel * vec4(aPos, 1.0);
+	lightCubeColor = aInstanceColor.rgb;
 }
\ No newline at end of file
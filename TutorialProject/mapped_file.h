@@ -0,0 +1,121 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//Read only memory mapping of a whole file, unmapped when the object goes away
+class MappedFile
+{
+public:
+    MappedFile() {}
+    ~MappedFile()
+    {
+        close();
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path)
+    {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+        {
+            close();
+            return false;
+        }
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL)
+        {
+            close();
+            return false;
+        }
+        view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (view == NULL)
+        {
+            close();
+            return false;
+        }
+        length = (size_t)fileSize.QuadPart;
+#else
+        descriptor = ::open(path.c_str(), O_RDONLY);
+        if (descriptor == -1)
+            return false;
+        struct stat info;
+        if (fstat(descriptor, &info) != 0 || info.st_size == 0)
+        {
+            close();
+            return false;
+        }
+        void* mapped = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapped == MAP_FAILED)
+        {
+            close();
+            return false;
+        }
+        view = mapped;
+        length = (size_t)info.st_size;
+#endif
+        return true;
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (view)
+            UnmapViewOfFile(view);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (view)
+            munmap(view, length);
+        if (descriptor != -1)
+            ::close(descriptor);
+        descriptor = -1;
+#endif
+        view = nullptr;
+        length = 0;
+    }
+
+    const unsigned char* data() const
+    {
+        return static_cast<const unsigned char*>(view);
+    }
+    size_t size() const
+    {
+        return length;
+    }
+
+private:
+    void* view = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#else
+    int descriptor = -1;
+#endif
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef MATERIAL_TABLE_H
+#define MATERIAL_TABLE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <algorithm>
+
+//How one object's surface is shaded, indexed per instance so objects with different materials can still share a draw.
+//Layers are into the scene's TextureArray, the second is sampled with mirrored u like texture2 always was
+struct Material
+{
+    unsigned int layer1 = 0;
+    unsigned int layer2 = 0;
+    //0 shows only layer1, 1 only layer2
+    float mixValue = 0.0f;
+    float ambientStrength = 0.1f;
+    float specularStrength = 0.5f;
+
+    bool operator==(const Material& other) const
+    {
+        return layer1 == other.layer1 && layer2 == other.layer2 && mixValue == other.mixValue
+            && ambientStrength == other.ambientStrength && specularStrength == other.specularStrength;
+    }
+};
+
+//Every material in an RGBA32F buffer texture, two texels each: (layer1, layer2, mix, 0) and (ambient, specular, 0, 0).
+//shader.fs fetches them with texelFetch from the instance's material index. Only re-uploaded after a change
+class MaterialTable
+{
+public:
+    static const unsigned int TEXELS_PER_MATERIAL = 2;
+
+    std::vector<Material> materials;
+    unsigned int buffer = 0;
+    unsigned int texture = 0;
+
+    void create()
+    {
+        glGenBuffers(1, &buffer);
+        glGenTextures(1, &texture);
+    }
+
+    void destroy()
+    {
+        glDeleteTextures(1, &texture);
+        glDeleteBuffers(1, &buffer);
+        texture = 0;
+        buffer = 0;
+    }
+
+    //Index of the new material
+    unsigned int add(const Material& material)
+    {
+        materials.push_back(material);
+        dirty = true;
+        return (unsigned int)materials.size() - 1;
+    }
+
+    void set(unsigned int index, const Material& material)
+    {
+        if (materials[index] == material)
+            return;
+        materials[index] = material;
+        dirty = true;
+    }
+
+    size_t size() const
+    {
+        return materials.size();
+    }
+
+    //Rebuild the buffer if anything changed since the last call. The buffer texture keeps its binding, so this is all a change costs
+    void upload()
+    {
+        if (!dirty)
+            return;
+        dirty = false;
+        texels.resize(materials.size() * TEXELS_PER_MATERIAL);
+        for (size_t i = 0; i < materials.size(); i++)
+        {
+            const Material& material = materials[i];
+            texels[i * TEXELS_PER_MATERIAL] = glm::vec4((float)material.layer1, (float)material.layer2, material.mixValue, 0.0f);
+            texels[i * TEXELS_PER_MATERIAL + 1] = glm::vec4(material.ambientStrength, material.specularStrength, 0.0f, 0.0f);
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        //Orphaned, so a frame still reading the old table isn't waited on
+        glBufferData(GL_TEXTURE_BUFFER, texels.size() * sizeof(glm::vec4), NULL, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, texels.size() * sizeof(glm::vec4), texels.data());
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        int previousTexture;
+        glGetIntegerv(GL_TEXTURE_BINDING_BUFFER, &previousTexture);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        //Attached here rather than in create() so the buffer has a data store by then
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, previousTexture);
+    }
+
+    //Lowest and highest of every material's mix value and specular strength, for picking shader permutations
+    void ranges(float& minMix, float& maxMix, float& maxSpecular) const
+    {
+        minMix = 1.0f;
+        maxMix = 0.0f;
+        maxSpecular = 0.0f;
+        for (const Material& material : materials)
+        {
+            minMix = std::min(minMix, material.mixValue);
+            maxMix = std::max(maxMix, material.mixValue);
+            maxSpecular = std::max(maxSpecular, material.specularStrength);
+        }
+    }
+
+private:
+    std::vector<glm::vec4> texels;
+    bool dirty = true;
+};
+
+#endif
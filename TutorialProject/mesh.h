@@ -0,0 +1,304 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <vector>
+#include <unordered_map>
+#include <cstring>
+#include <cstddef>
+
+//Full precision vertex as authored, packed down by the MeshBuilder
+struct MeshVertex
+{
+    glm::vec3 position;
+    glm::vec2 texCoord;
+    glm::vec3 color;
+    glm::vec3 normal;
+};
+
+//GPU vertex layout, 24 bytes instead of the 44 of the float only layout
+struct PackedVertex
+{
+    //Full floats, positions need the precision and the light cube shares this stream
+    float position[3];
+    //Two half floats
+    unsigned int texCoord;
+    //GL_INT_2_10_10_10_REV, w unused
+    unsigned int normal;
+    //Four normalized unsigned bytes, alpha unused
+    unsigned int color;
+};
+
+//One level of detail, a range of the mesh's element buffer
+struct MeshLod
+{
+    GLsizei indexCount = 0;
+    //Byte offset into the element buffer, passed as the indices pointer of the draw
+    size_t indexOffset = 0;
+};
+
+//Uploaded mesh, VAO is set up for attribute locations 0-3 (position, texture coords, color, normal)
+struct Mesh
+{
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+    unsigned int EBO = 0;
+    GLsizei indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_SHORT;
+    size_t vertexBytes = 0;
+    size_t indexBytes = 0;
+    //Finest first, all sharing one vertex buffer. A mesh built without LODs has a single one covering every index
+    std::vector<MeshLod> lods;
+};
+
+//Point attribute locations 0-3 of the bound VAO at PackedVertex records in the bound GL_ARRAY_BUFFER
+inline void setPackedVertexAttributes()
+{
+    //Position
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+    glEnableVertexAttribArray(0);
+    //Texture coords
+    glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoord));
+    glEnableVertexAttribArray(1);
+    //Color
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, color));
+    glEnableVertexAttribArray(2);
+    //Normal
+    glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+    glEnableVertexAttribArray(3);
+}
+
+//Collects triangle list vertices, merges duplicates and builds an indexed, packed mesh
+class MeshBuilder
+{
+public:
+    std::vector<PackedVertex> vertices;
+    std::vector<unsigned int> indices;
+
+    //Add the next triangle list vertex, reusing an identical packed vertex if one exists
+    void addVertex(const MeshVertex& vertex)
+    {
+        PackedVertex packed = pack(vertex);
+        auto it = lookup.find(packed);
+        if (it != lookup.end())
+        {
+            indices.push_back(it->second);
+            return;
+        }
+        unsigned int index = (unsigned int)vertices.size();
+        vertices.push_back(packed);
+        lookup.emplace(packed, index);
+        indices.push_back(index);
+    }
+
+    //Vertices added from here on make up the next level of detail. Identical vertices are still shared with earlier levels
+    void beginLod()
+    {
+        lodStarts.push_back((unsigned int)indices.size());
+    }
+
+    //Create VAO/VBO/EBO, indices are stored as 16 bit when the vertex count allows it
+    Mesh upload() const
+    {
+        Mesh mesh;
+        glGenVertexArrays(1, &mesh.VAO);
+        glBindVertexArray(mesh.VAO);
+
+        glGenBuffers(1, &mesh.VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+        mesh.vertexBytes = vertices.size() * sizeof(PackedVertex);
+        glBufferData(GL_ARRAY_BUFFER, mesh.vertexBytes, vertices.data(), GL_STATIC_DRAW);
+
+        glGenBuffers(1, &mesh.EBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+        mesh.indexCount = (GLsizei)indices.size();
+        if (vertices.size() <= 0xFFFF)
+        {
+            std::vector<unsigned short> shortIndices(indices.begin(), indices.end());
+            mesh.indexType = GL_UNSIGNED_SHORT;
+            mesh.indexBytes = shortIndices.size() * sizeof(unsigned short);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBytes, shortIndices.data(), GL_STATIC_DRAW);
+        }
+        else
+        {
+            mesh.indexType = GL_UNSIGNED_INT;
+            mesh.indexBytes = indices.size() * sizeof(unsigned int);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBytes, indices.data(), GL_STATIC_DRAW);
+        }
+        size_t indexSize = mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+        mesh.lods = lodRanges(0, indexSize);
+        setPackedVertexAttributes();
+
+        //The element buffer binding is VAO state, so only unbind it after the VAO
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        return mesh;
+    }
+
+    //Index ranges of the levels of detail, for indices placed firstIndex indices into an element buffer of indexSize byte indices
+    std::vector<MeshLod> lodRanges(size_t firstIndex, size_t indexSize) const
+    {
+        std::vector<unsigned int> starts = lodStarts;
+        if (starts.empty() || starts[0] != 0)
+            starts.insert(starts.begin(), 0u);
+        std::vector<MeshLod> lods;
+        for (size_t i = 0; i < starts.size(); i++)
+        {
+            MeshLod lod;
+            unsigned int end = i + 1 < starts.size() ? starts[i + 1] : (unsigned int)indices.size();
+            lod.indexCount = (GLsizei)(end - starts[i]);
+            lod.indexOffset = (firstIndex + starts[i]) * indexSize;
+            lods.push_back(lod);
+        }
+        return lods;
+    }
+
+private:
+    struct PackedVertexHash
+    {
+        size_t operator()(const PackedVertex& vertex) const
+        {
+            //FNV-1a over the packed bytes
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&vertex);
+            size_t hash = 2166136261u;
+            for (size_t i = 0; i < sizeof(PackedVertex); i++)
+            {
+                hash ^= bytes[i];
+                hash *= 16777619u;
+            }
+            return hash;
+        }
+    };
+    struct PackedVertexEqual
+    {
+        bool operator()(const PackedVertex& a, const PackedVertex& b) const
+        {
+            return std::memcmp(&a, &b, sizeof(PackedVertex)) == 0;
+        }
+    };
+    std::unordered_map<PackedVertex, unsigned int, PackedVertexHash, PackedVertexEqual> lookup;
+    //First index of each level of detail
+    std::vector<unsigned int> lodStarts;
+
+    static PackedVertex pack(const MeshVertex& vertex)
+    {
+        PackedVertex packed;
+        packed.position[0] = vertex.position.x;
+        packed.position[1] = vertex.position.y;
+        packed.position[2] = vertex.position.z;
+        packed.texCoord = glm::packHalf2x16(vertex.texCoord);
+        packed.normal = glm::packSnorm3x10_1x2(glm::vec4(vertex.normal, 0.0f));
+        packed.color = glm::packUnorm4x8(glm::vec4(vertex.color, 1.0f));
+        return packed;
+    }
+};
+
+//Several builders' meshes in one vertex buffer and one element buffer behind one VAO, so all of them can go out in a single
+//multi-draw. Indices are rebased as meshes are added, so every pooled Mesh also draws on its own with plain glDrawElements
+class MeshPool
+{
+public:
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+    unsigned int EBO = 0;
+    //Shared by every pooled mesh, 16 bit while the pool's vertex count allows it
+    GLenum indexType = GL_UNSIGNED_SHORT;
+    //Filled in by upload, in the order added
+    std::vector<Mesh> meshes;
+
+    //Append a builder's vertices and indices, returns the mesh's index in meshes. Call before upload
+    unsigned int add(const MeshBuilder& builder)
+    {
+        unsigned int baseVertex = (unsigned int)vertices.size();
+        firstIndices.push_back(indices.size());
+        builders.push_back(&builder);
+        vertices.insert(vertices.end(), builder.vertices.begin(), builder.vertices.end());
+        for (unsigned int index : builder.indices)
+            indices.push_back(baseVertex + index);
+        return (unsigned int)builders.size() - 1;
+    }
+
+    //Create the shared buffers and the Mesh of everything added. Builders passed to add have to still be around
+    void upload()
+    {
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(PackedVertex), vertices.data(), GL_STATIC_DRAW);
+        glGenBuffers(1, &EBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        indexType = vertices.size() <= 0xFFFF ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+        if (indexType == GL_UNSIGNED_SHORT)
+        {
+            std::vector<unsigned short> shortIndices(indices.begin(), indices.end());
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * indexSize, shortIndices.data(), GL_STATIC_DRAW);
+        }
+        else
+        {
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * indexSize, indices.data(), GL_STATIC_DRAW);
+        }
+        setPackedVertexAttributes();
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+        meshes.clear();
+        for (size_t i = 0; i < builders.size(); i++)
+        {
+            Mesh mesh;
+            mesh.VAO = VAO;
+            mesh.VBO = VBO;
+            mesh.EBO = EBO;
+            mesh.indexType = indexType;
+            mesh.indexCount = (GLsizei)builders[i]->indices.size();
+            mesh.vertexBytes = builders[i]->vertices.size() * sizeof(PackedVertex);
+            mesh.indexBytes = builders[i]->indices.size() * indexSize;
+            mesh.lods = builders[i]->lodRanges(firstIndices[i], indexSize);
+            meshes.push_back(mesh);
+        }
+        builders.clear();
+        firstIndices.clear();
+        vertices.clear();
+        vertices.shrink_to_fit();
+        indices.clear();
+        indices.shrink_to_fit();
+    }
+
+    void destroy()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        meshes.clear();
+    }
+
+private:
+    std::vector<PackedVertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<const MeshBuilder*> builders;
+    std::vector<size_t> firstIndices;
+};
+
+//Second VAO over a mesh's buffers that only reads positions, for passes that don't need the other attributes
+inline unsigned int createPositionOnlyVAO(const Mesh& mesh)
+{
+    unsigned int VAO;
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    return VAO;
+}
+
+#endif
@@ -0,0 +1,596 @@
+#ifndef MESH_IMPORT_H
+#define MESH_IMPORT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "mesh.h"
+#include "mapped_file.h"
+#include "json_reader.h"
+#include "thread_pool.h"
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cfloat>
+#include <cmath>
+#include <cctype>
+#include <iostream>
+
+//Meshes loaded from a model file, one per glTF primitive. Every VAO feeds attribute locations 0-3 (position, texture coords,
+//color, normal) like MeshBuilder's, though not necessarily with PackedVertex's layout, so createPositionOnlyVAO doesn't apply.
+//An OBJ only fills in the bounds and sizes here, its vertices go through a MeshBuilder (see loadObj). Call destroy on the GL thread when done
+struct ImportedModel
+{
+    std::vector<Mesh> meshes;
+    //GL buffers shared between meshes, one per glTF buffer view
+    std::vector<unsigned int> buffers;
+    glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+    glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+    size_t vertexBytes = 0;
+    size_t indexBytes = 0;
+    unsigned long long triangles = 0;
+
+    void destroy()
+    {
+        for (Mesh& mesh : meshes)
+            glDeleteVertexArrays(1, &mesh.VAO);
+        if (!buffers.empty())
+            glDeleteBuffers((GLsizei)buffers.size(), buffers.data());
+        meshes.clear();
+        buffers.clear();
+    }
+};
+
+inline std::uint32_t readLittleEndian32(const unsigned char* bytes)
+{
+    return (std::uint32_t)bytes[0] | ((std::uint32_t)bytes[1] << 8) | ((std::uint32_t)bytes[2] << 16) | ((std::uint32_t)bytes[3] << 24);
+}
+
+//Binary glTF 2.0. The file is mapped and every buffer view a primitive reads is handed to glBufferData straight from the
+//mapping, attributes and indices are then pointed at their accessors' offsets, so nothing is copied on the CPU side. Indices are
+//only read to check they stay inside every attribute, the GL doesn't bounds check vertex fetches.
+//Node transforms, materials, sparse accessors and external buffers aren't supported; the meshes come out in model space
+inline bool importGlb(const std::string& path, ImportedModel& model)
+{
+    const std::uint32_t GLB_MAGIC = 0x46546C67;
+    const std::uint32_t CHUNK_JSON = 0x4E4F534A;
+    const std::uint32_t CHUNK_BIN = 0x004E4942;
+    MappedFile file;
+    if (!file.open(path))
+    {
+        std::cout << "ERROR::MESH_IMPORT::FILE_NOT_SUCCESSFULLY_READ " << path << std::endl;
+        return false;
+    }
+    const unsigned char* data = file.data();
+    size_t size = file.size();
+    if (size < 20 || readLittleEndian32(data) != GLB_MAGIC || readLittleEndian32(data + 4) != 2 || readLittleEndian32(data + 16) != CHUNK_JSON)
+    {
+        std::cout << "ERROR::MESH_IMPORT::NOT_GLB_2 " << path << std::endl;
+        return false;
+    }
+    size_t jsonLength = readLittleEndian32(data + 12);
+    if (jsonLength > size - 20)
+    {
+        std::cout << "ERROR::MESH_IMPORT::TRUNCATED " << path << std::endl;
+        return false;
+    }
+    const char* jsonBegin = reinterpret_cast<const char*>(data + 20);
+    const char* jsonEnd = jsonBegin + jsonLength;
+    //Some exporters pad with zeros instead of spaces
+    while (jsonEnd > jsonBegin && jsonEnd[-1] == '\0')
+        jsonEnd--;
+    JsonValue json;
+    JsonReader reader;
+    if (!reader.parse(jsonBegin, jsonEnd, json))
+    {
+        std::cout << "ERROR::MESH_IMPORT::INVALID_JSON at byte " << reader.errorOffset << " of " << path << std::endl;
+        return false;
+    }
+    //Optional binary chunk right after the 4 byte aligned JSON chunk
+    const unsigned char* bin = nullptr;
+    size_t binLength = 0;
+    size_t binHeader = 20 + ((jsonLength + 3) & ~(size_t)3);
+    if (binHeader + 8 <= size && readLittleEndian32(data + binHeader + 4) == CHUNK_BIN)
+    {
+        binLength = readLittleEndian32(data + binHeader);
+        bin = data + binHeader + 8;
+        if (binLength > size - binHeader - 8)
+        {
+            std::cout << "ERROR::MESH_IMPORT::TRUNCATED " << path << std::endl;
+            return false;
+        }
+    }
+
+    const JsonValue& accessors = json["accessors"];
+    const JsonValue& views = json["bufferViews"];
+    const JsonValue& buffers = json["buffers"];
+    //GL buffer of each view, created the first time an accessor needs it
+    std::vector<unsigned int> viewBuffers(views.size(), 0);
+
+    //An accessor resolved to the GL buffer holding it and where in that buffer it starts
+    struct Accessor
+    {
+        unsigned int buffer = 0;
+        size_t offset = 0;
+        //First element in the mapped file
+        const unsigned char* data = nullptr;
+        GLsizei stride = 0;
+        GLenum componentType = 0;
+        GLint components = 0;
+        GLboolean normalized = GL_FALSE;
+        size_t count = 0;
+    };
+    auto resolve = [&](const JsonValue& index, Accessor& result) {
+        if (index.type != JsonValue::NUMBER || index.number < 0.0)
+            return false;
+        const JsonValue& accessor = accessors[(size_t)index.number];
+        const JsonValue& viewIndex = accessor["bufferView"];
+        if (accessor.type != JsonValue::OBJECT || viewIndex.type != JsonValue::NUMBER || accessor.has("sparse"))
+            return false;
+        size_t viewNumber = (size_t)viewIndex.number;
+        const JsonValue& view = views[viewNumber];
+        if (view.type != JsonValue::OBJECT)
+            return false;
+        //Only the GLB's own binary chunk, buffer 0 without a uri
+        size_t bufferNumber = (size_t)view["buffer"].numberOr(0.0);
+        if (bufferNumber != 0 || buffers[bufferNumber].has("uri") || !bin)
+            return false;
+
+        const std::string& type = accessor["type"].string;
+        result.components = type == "SCALAR" ? 1 : type == "VEC2" ? 2 : type == "VEC3" ? 3 : type == "VEC4" ? 4 : 0;
+        //glTF component types are the GL enums
+        result.componentType = (GLenum)accessor["componentType"].numberOr(0.0);
+        size_t componentSize = 0;
+        switch (result.componentType)
+        {
+        case GL_BYTE: case GL_UNSIGNED_BYTE: componentSize = 1; break;
+        case GL_SHORT: case GL_UNSIGNED_SHORT: componentSize = 2; break;
+        case GL_UNSIGNED_INT: case GL_FLOAT: componentSize = 4; break;
+        }
+        if (result.components == 0 || componentSize == 0)
+            return false;
+        result.normalized = accessor["normalized"].booleanOr(false) ? GL_TRUE : GL_FALSE;
+        result.count = (size_t)accessor["count"].numberOr(0.0);
+        result.offset = (size_t)accessor["byteOffset"].numberOr(0.0);
+        result.stride = (GLsizei)view["byteStride"].numberOr(0.0);
+
+        size_t viewOffset = (size_t)view["byteOffset"].numberOr(0.0);
+        size_t viewLength = (size_t)view["byteLength"].numberOr(0.0);
+        size_t elementSize = componentSize * result.components;
+        size_t stride = result.stride ? (size_t)result.stride : elementSize;
+        if (viewOffset > binLength || viewLength > binLength - viewOffset || result.count == 0
+            || result.offset + stride * (result.count - 1) + elementSize > viewLength)
+            return false;
+
+        if (viewBuffers[viewNumber] == 0)
+        {
+            unsigned int buffer;
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            glBufferData(GL_ARRAY_BUFFER, viewLength, bin + viewOffset, GL_STATIC_DRAW);
+            viewBuffers[viewNumber] = buffer;
+            model.buffers.push_back(buffer);
+            if (view["target"].numberOr(0.0) == GL_ELEMENT_ARRAY_BUFFER)
+                model.indexBytes += viewLength;
+            else
+                model.vertexBytes += viewLength;
+        }
+        result.buffer = viewBuffers[viewNumber];
+        result.data = bin + viewOffset + result.offset;
+        return true;
+    };
+    auto bindAttribute = [](GLuint location, const Accessor& accessor) {
+        glBindBuffer(GL_ARRAY_BUFFER, accessor.buffer);
+        glVertexAttribPointer(location, accessor.components, accessor.componentType, accessor.normalized, accessor.stride, (void*)accessor.offset);
+        glEnableVertexAttribArray(location);
+    };
+
+    const JsonValue& meshes = json["meshes"];
+    for (size_t meshIndex = 0; meshIndex < meshes.size(); meshIndex++)
+    {
+        const JsonValue& primitives = meshes[meshIndex]["primitives"];
+        for (size_t primitiveIndex = 0; primitiveIndex < primitives.size(); primitiveIndex++)
+        {
+            const JsonValue& primitive = primitives[primitiveIndex];
+            const JsonValue& attributes = primitive["attributes"];
+            Accessor position;
+            bool supported = primitive["mode"].numberOr(GL_TRIANGLES) == GL_TRIANGLES && resolve(attributes["POSITION"], position)
+                && position.componentType == GL_FLOAT && position.components == 3;
+            //Optional attributes at locations 1-3, each has to cover every vertex POSITION does
+            const char* const OPTIONAL_ATTRIBUTES[] = { "TEXCOORD_0", "COLOR_0", "NORMAL" };
+            Accessor optional[3];
+            bool present[3] = {};
+            for (unsigned int i = 0; i < 3 && supported; i++)
+            {
+                present[i] = resolve(attributes[OPTIONAL_ATTRIBUTES[i]], optional[i]);
+                supported = !present[i] || optional[i].count >= position.count;
+            }
+            Accessor indices;
+            bool indexed = primitive.has("indices");
+            //Indices that can't be used are an error rather than a reason to draw the vertices as a plain triangle list
+            if (indexed)
+                supported = supported && resolve(primitive["indices"], indices) && indices.components == 1 && indices.stride == 0
+                    && (indices.componentType == GL_UNSIGNED_BYTE || indices.componentType == GL_UNSIGNED_SHORT || indices.componentType == GL_UNSIGNED_INT)
+                    && indices.count % 3 == 0;
+            else
+                supported = supported && position.count % 3 == 0;
+            for (size_t i = 0; indexed && supported && i < indices.count; i++)
+            {
+                size_t index = indices.componentType == GL_UNSIGNED_BYTE ? indices.data[i]
+                    : indices.componentType == GL_UNSIGNED_SHORT ? (size_t)indices.data[i * 2] | ((size_t)indices.data[i * 2 + 1] << 8)
+                    : (size_t)readLittleEndian32(indices.data + i * 4);
+                supported = index < position.count;
+            }
+            if (!supported)
+            {
+                std::cout << "ERROR::MESH_IMPORT::UNSUPPORTED_PRIMITIVE " << meshIndex << "." << primitiveIndex << " of " << path << std::endl;
+                continue;
+            }
+
+            Mesh mesh;
+            glGenVertexArrays(1, &mesh.VAO);
+            glBindVertexArray(mesh.VAO);
+            bindAttribute(0, position);
+            for (unsigned int i = 0; i < 3; i++)
+            {
+                if (present[i])
+                    bindAttribute(i + 1, optional[i]);
+            }
+
+            MeshLod lod;
+            if (indexed)
+            {
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices.buffer);
+                mesh.indexType = indices.componentType;
+                lod.indexCount = (GLsizei)indices.count;
+                lod.indexOffset = indices.offset;
+            }
+            else
+            {
+                //Unindexed, the one thing that does need generating. Goes in a buffer of the model's so destroy frees it
+                std::vector<unsigned int> sequence(position.count);
+                for (size_t i = 0; i < sequence.size(); i++)
+                    sequence[i] = (unsigned int)i;
+                unsigned int buffer;
+                glGenBuffers(1, &buffer);
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, sequence.size() * sizeof(unsigned int), sequence.data(), GL_STATIC_DRAW);
+                model.buffers.push_back(buffer);
+                model.indexBytes += sequence.size() * sizeof(unsigned int);
+                mesh.indexType = GL_UNSIGNED_INT;
+                lod.indexCount = (GLsizei)sequence.size();
+            }
+            mesh.indexCount = lod.indexCount;
+            mesh.lods.push_back(lod);
+            glBindVertexArray(0);
+            model.meshes.push_back(mesh);
+            model.triangles += (unsigned long long)lod.indexCount / 3;
+
+            //POSITION has to carry min and max, so the bounds don't need the vertices read
+            const JsonValue& accessor = accessors[(size_t)attributes["POSITION"].number];
+            const JsonValue& minimum = accessor["min"];
+            const JsonValue& maximum = accessor["max"];
+            for (unsigned int axis = 0; axis < 3; axis++)
+            {
+                model.boundsMin[axis] = std::fmin(model.boundsMin[axis], (float)minimum[axis].numberOr(0.0));
+                model.boundsMax[axis] = std::fmax(model.boundsMax[axis], (float)maximum[axis].numberOr(0.0));
+            }
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    //Attributes a primitive doesn't have read the current generic value instead. That's context state rather than VAO state,
+    //harmless here since every VAO that reads locations 2 and 3 from the cube mesh enables them as arrays
+    glVertexAttrib4f(2, 1.0f, 1.0f, 1.0f, 1.0f);
+    glVertexAttrib4f(3, 0.0f, 0.0f, 1.0f, 0.0f);
+    return !model.meshes.empty();
+}
+
+//Number parsing for the OBJ reader, bounded by end since mapped files aren't null terminated
+inline bool parseObjFloat(const char*& p, const char* end, float& value)
+{
+    const char* begin = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+    double mantissa = 0.0;
+    int exponent = 0;
+    bool digits = false;
+    for (; p < end && *p >= '0' && *p <= '9'; p++, digits = true)
+        mantissa = mantissa * 10.0 + (*p - '0');
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits = true)
+        {
+            mantissa = mantissa * 10.0 + (*p - '0');
+            exponent--;
+        }
+    }
+    if (!digits)
+    {
+        p = begin;
+        return false;
+    }
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char* exponentStart = p++;
+        bool negativeExponent = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negativeExponent = *p++ == '-';
+        if (p < end && *p >= '0' && *p <= '9')
+        {
+            int written = 0;
+            for (; p < end && *p >= '0' && *p <= '9'; p++)
+                written = written < 1000 ? written * 10 + (*p - '0') : written;
+            exponent += negativeExponent ? -written : written;
+        }
+        else
+        {
+            p = exponentStart;
+        }
+    }
+    value = (float)(mantissa * std::pow(10.0, exponent));
+    if (negative)
+        value = -value;
+    return true;
+}
+
+inline bool parseObjInt(const char*& p, const char* end, int& value)
+{
+    bool negative = false;
+    const char* begin = p;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+    if (p >= end || *p < '0' || *p > '9')
+    {
+        p = begin;
+        return false;
+    }
+    long long result = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
+        result = result < 0x7FFFFFFF ? result * 10 + (*p - '0') : result;
+    value = (int)(negative ? -result : result);
+    return true;
+}
+
+//One corner of an OBJ face. Indices are 1 based and global as written, 0 where absent. Negative ones count back from what came
+//before them, and since earlier chunks' sizes aren't known while parsing, those are stored 0 based from the start of their chunk
+//(negative if they reach into an earlier one) with their bit set in relative
+struct ObjCorner
+{
+    int position = 0;
+    int texCoord = 0;
+    int normal = 0;
+    unsigned char relative = 0;
+};
+
+//What one chunk of an OBJ file defines
+struct ObjChunk
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> colors;
+    std::vector<glm::vec2> texCoords;
+    std::vector<glm::vec3> normals;
+    //Three per triangle
+    std::vector<ObjCorner> corners;
+    bool hasColors = false;
+};
+
+inline void parseObjChunk(const char* p, const char* end, ObjChunk& chunk)
+{
+    auto skipSpaces = [&]() {
+        while (p < end && (*p == ' ' || *p == '\t'))
+            p++;
+    };
+    //Negative indices to chunk relative ones, see ObjCorner
+    auto encode = [](int& index, size_t localCount, unsigned char bit, unsigned char& relative) {
+        if (index >= 0)
+            return;
+        index += (int)localCount;
+        relative |= bit;
+    };
+    std::vector<ObjCorner> face;
+    while (p < end)
+    {
+        skipSpaces();
+        const char* keyword = p;
+        while (p < end && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r')
+            p++;
+        size_t keywordLength = (size_t)(p - keyword);
+        if (keywordLength == 1 && keyword[0] == 'v')
+        {
+            glm::vec3 position(0.0f);
+            glm::vec3 color(1.0f);
+            for (unsigned int i = 0; i < 3; i++)
+            {
+                skipSpaces();
+                parseObjFloat(p, end, position[i]);
+            }
+            //Vertex colors are a common extension, three more numbers on the position line
+            skipSpaces();
+            if (parseObjFloat(p, end, color[0]))
+            {
+                for (unsigned int i = 1; i < 3; i++)
+                {
+                    skipSpaces();
+                    parseObjFloat(p, end, color[i]);
+                }
+                chunk.hasColors = true;
+            }
+            chunk.positions.push_back(position);
+            chunk.colors.push_back(color);
+        }
+        else if (keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 't')
+        {
+            glm::vec2 texCoord(0.0f);
+            for (unsigned int i = 0; i < 2; i++)
+            {
+                skipSpaces();
+                parseObjFloat(p, end, texCoord[i]);
+            }
+            chunk.texCoords.push_back(texCoord);
+        }
+        else if (keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 'n')
+        {
+            glm::vec3 normal(0.0f);
+            for (unsigned int i = 0; i < 3; i++)
+            {
+                skipSpaces();
+                parseObjFloat(p, end, normal[i]);
+            }
+            chunk.normals.push_back(normal);
+        }
+        else if (keywordLength == 1 && keyword[0] == 'f')
+        {
+            //v, v/vt, v//vn or v/vt/vn per corner
+            face.clear();
+            while (true)
+            {
+                skipSpaces();
+                ObjCorner corner;
+                if (!parseObjInt(p, end, corner.position))
+                    break;
+                if (p < end && *p == '/')
+                {
+                    p++;
+                    parseObjInt(p, end, corner.texCoord);
+                    if (p < end && *p == '/')
+                    {
+                        p++;
+                        parseObjInt(p, end, corner.normal);
+                    }
+                }
+                encode(corner.position, chunk.positions.size(), 1, corner.relative);
+                encode(corner.texCoord, chunk.texCoords.size(), 2, corner.relative);
+                encode(corner.normal, chunk.normals.size(), 4, corner.relative);
+                face.push_back(corner);
+            }
+            //Fan out polygons, first corner shared by every triangle
+            for (size_t corner = 2; corner < face.size(); corner++)
+            {
+                chunk.corners.push_back(face[0]);
+                chunk.corners.push_back(face[corner - 1]);
+                chunk.corners.push_back(face[corner]);
+            }
+        }
+        //Anything else (comments, groups, materials) is skipped to the end of the line
+        while (p < end && *p != '\n')
+            p++;
+        if (p < end)
+            p++;
+    }
+}
+
+//Wavefront OBJ for older assets. The mapped file is cut into line aligned chunks that are parsed on the thread pool, then the
+//faces are resolved in file order and go through a MeshBuilder like the cube, so the result is indexed and packed. Faces
+//without normals get flat ones. Materials and groups are ignored, the whole file becomes one mesh. Only fills builder and the
+//model's bounds, so the vertices can go into a MeshPool instead of buffers of their own
+inline bool loadObj(const std::string& path, ThreadPool& pool, MeshBuilder& builder, ImportedModel& model)
+{
+    const size_t CHUNK_BYTES = 1 << 20;
+    MappedFile file;
+    if (!file.open(path))
+    {
+        std::cout << "ERROR::MESH_IMPORT::FILE_NOT_SUCCESSFULLY_READ " << path << std::endl;
+        return false;
+    }
+    const char* begin = reinterpret_cast<const char*>(file.data());
+    const char* end = begin + file.size();
+    std::vector<const char*> starts;
+    for (const char* p = begin; p < end;)
+    {
+        starts.push_back(p);
+        const char* next = p + CHUNK_BYTES < end ? p + CHUNK_BYTES : end;
+        const char* newline = (const char*)std::memchr(next, '\n', (size_t)(end - next));
+        p = newline ? newline + 1 : end;
+    }
+    starts.push_back(end);
+    std::vector<ObjChunk> chunks(starts.size() - 1);
+    pool.parallelFor((unsigned int)chunks.size(), 1, [&](unsigned int first, unsigned int last) {
+        for (unsigned int i = first; i < last; i++)
+            parseObjChunk(starts[i], starts[i + 1], chunks[i]);
+    });
+
+    //Everything in file order, so global indices can be looked up directly
+    ObjChunk merged;
+    std::vector<size_t> positionBases, texCoordBases, normalBases;
+    for (ObjChunk& chunk : chunks)
+    {
+        positionBases.push_back(merged.positions.size());
+        texCoordBases.push_back(merged.texCoords.size());
+        normalBases.push_back(merged.normals.size());
+        merged.positions.insert(merged.positions.end(), chunk.positions.begin(), chunk.positions.end());
+        merged.colors.insert(merged.colors.end(), chunk.colors.begin(), chunk.colors.end());
+        merged.texCoords.insert(merged.texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+        merged.normals.insert(merged.normals.end(), chunk.normals.begin(), chunk.normals.end());
+        merged.hasColors = merged.hasColors || chunk.hasColors;
+    }
+    //0 based global index, or -1 if absent or out of range
+    auto resolve = [](int index, bool relative, size_t base, size_t count) -> long long {
+        long long global = relative ? (long long)base + index : index > 0 ? (long long)index - 1 : -1;
+        return global >= 0 && global < (long long)count ? global : -1;
+    };
+
+    for (size_t chunkIndex = 0; chunkIndex < chunks.size(); chunkIndex++)
+    {
+        const std::vector<ObjCorner>& corners = chunks[chunkIndex].corners;
+        for (size_t triangle = 0; triangle + 3 <= corners.size(); triangle += 3)
+        {
+            MeshVertex vertices[3];
+            bool valid = true;
+            bool hasNormals = true;
+            for (unsigned int corner = 0; corner < 3; corner++)
+            {
+                const ObjCorner& indices = corners[triangle + corner];
+                long long position = resolve(indices.position, (indices.relative & 1) != 0, positionBases[chunkIndex], merged.positions.size());
+                long long texCoord = resolve(indices.texCoord, (indices.relative & 2) != 0, texCoordBases[chunkIndex], merged.texCoords.size());
+                long long normal = resolve(indices.normal, (indices.relative & 4) != 0, normalBases[chunkIndex], merged.normals.size());
+                if (position < 0)
+                {
+                    valid = false;
+                    break;
+                }
+                vertices[corner].position = merged.positions[(size_t)position];
+                vertices[corner].color = merged.colors[(size_t)position];
+                vertices[corner].texCoord = texCoord >= 0 ? merged.texCoords[(size_t)texCoord] : glm::vec2(0.0f);
+                vertices[corner].normal = normal >= 0 ? merged.normals[(size_t)normal] : glm::vec3(0.0f);
+                hasNormals = hasNormals && normal >= 0;
+            }
+            if (!valid)
+                continue;
+            if (!hasNormals)
+            {
+                glm::vec3 faceNormal = glm::cross(vertices[1].position - vertices[0].position, vertices[2].position - vertices[0].position);
+                float length = glm::length(faceNormal);
+                faceNormal = length > 0.0f ? faceNormal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+                for (MeshVertex& vertex : vertices)
+                    vertex.normal = faceNormal;
+            }
+            for (const MeshVertex& vertex : vertices)
+            {
+                builder.addVertex(vertex);
+                model.boundsMin = glm::min(model.boundsMin, vertex.position);
+                model.boundsMax = glm::max(model.boundsMax, vertex.position);
+            }
+        }
+    }
+    if (builder.indices.empty())
+    {
+        std::cout << "ERROR::MESH_IMPORT::NO_FACES " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//Lower case extension without the dot, empty if there isn't one
+inline std::string fileExtension(const std::string& path)
+{
+    size_t dot = path.find_last_of("./\\");
+    std::string extension = dot == std::string::npos || path[dot] != '.' ? "" : path.substr(dot + 1);
+    for (char& c : extension)
+        c = (char)std::tolower((unsigned char)c);
+    return extension;
+}
+
+#endif
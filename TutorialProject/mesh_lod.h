@@ -0,0 +1,179 @@
+#ifndef MESH_LOD_H
+#define MESH_LOD_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include "mesh.h"
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+//Split every quad of a triangle list into a subdivisions x subdivisions grid, attributes interpolated bilinearly.
+//Quads are two triangles A B C, C D A in a row, the layout the cube's vertex array uses
+inline std::vector<MeshVertex> tessellateQuads(const std::vector<MeshVertex>& triangles, unsigned int subdivisions)
+{
+    std::vector<MeshVertex> result;
+    for (size_t quad = 0; quad + 6 <= triangles.size(); quad += 6)
+    {
+        const MeshVertex& a = triangles[quad];
+        const MeshVertex& b = triangles[quad + 1];
+        const MeshVertex& c = triangles[quad + 2];
+        const MeshVertex& d = triangles[quad + 4];
+        auto at = [&](unsigned int i, unsigned int j) {
+            float u = i / (float)subdivisions;
+            float v = j / (float)subdivisions;
+            MeshVertex vertex;
+            vertex.position = glm::mix(glm::mix(a.position, b.position, u), glm::mix(d.position, c.position, u), v);
+            vertex.texCoord = glm::mix(glm::mix(a.texCoord, b.texCoord, u), glm::mix(d.texCoord, c.texCoord, u), v);
+            vertex.color = glm::mix(glm::mix(a.color, b.color, u), glm::mix(d.color, c.color, u), v);
+            vertex.normal = a.normal;
+            return vertex;
+        };
+        for (unsigned int j = 0; j < subdivisions; j++)
+        {
+            for (unsigned int i = 0; i < subdivisions; i++)
+            {
+                //Same winding as the quad's own two triangles
+                result.push_back(at(i, j));
+                result.push_back(at(i + 1, j));
+                result.push_back(at(i + 1, j + 1));
+                result.push_back(at(i + 1, j + 1));
+                result.push_back(at(i, j + 1));
+                result.push_back(at(i, j));
+            }
+        }
+    }
+    return result;
+}
+
+//Vertex clustering simplifier. Positions snap to a grid of cellSize, every vertex in a cell collapses onto the one nearest the
+//cell's center, and triangles left with fewer than three distinct corners are dropped. Vertices only cluster with others of the
+//same normal, so hard edges stay hard. Crude next to edge collapse, but cheap enough to run at load time
+inline std::vector<MeshVertex> simplifyByClustering(const std::vector<MeshVertex>& triangles, float cellSize)
+{
+    struct CellKey
+    {
+        int x, y, z;
+        unsigned int normal;
+        bool operator==(const CellKey& other) const
+        {
+            return x == other.x && y == other.y && z == other.z && normal == other.normal;
+        }
+    };
+    struct CellKeyHash
+    {
+        size_t operator()(const CellKey& key) const
+        {
+            size_t hash = 2166136261u;
+            const unsigned int values[4] = { (unsigned int)key.x, (unsigned int)key.y, (unsigned int)key.z, key.normal };
+            for (unsigned int value : values)
+            {
+                hash ^= value;
+                hash *= 16777619u;
+            }
+            return hash;
+        }
+    };
+    //Representative vertex of each cell, and how far it is from the cell's center
+    struct Cell
+    {
+        unsigned int vertex;
+        float distance;
+    };
+    std::unordered_map<CellKey, Cell, CellKeyHash> cells;
+    std::vector<CellKey> keys(triangles.size());
+    for (size_t i = 0; i < triangles.size(); i++)
+    {
+        glm::vec3 grid = glm::round(triangles[i].position / cellSize);
+        CellKey key = { (int)grid.x, (int)grid.y, (int)grid.z, glm::packSnorm3x10_1x2(glm::vec4(triangles[i].normal, 0.0f)) };
+        float distance = glm::length(triangles[i].position - grid * cellSize);
+        keys[i] = key;
+        auto it = cells.find(key);
+        if (it == cells.end())
+            cells.emplace(key, Cell{ (unsigned int)i, distance });
+        else if (distance < it->second.distance)
+            it->second = Cell{ (unsigned int)i, distance };
+    }
+
+    std::vector<MeshVertex> result;
+    for (size_t i = 0; i + 3 <= triangles.size(); i += 3)
+    {
+        unsigned int corners[3];
+        for (unsigned int corner = 0; corner < 3; corner++)
+            corners[corner] = cells[keys[i + corner]].vertex;
+        if (corners[0] == corners[1] || corners[1] == corners[2] || corners[2] == corners[0])
+            continue;
+        for (unsigned int corner = 0; corner < 3; corner++)
+            result.push_back(triangles[corners[corner]]);
+    }
+    return result;
+}
+
+//Add triangles to builder as LOD 0 followed by up to maxLevels - 1 coarser levels, simplified with a cell size starting at
+//cellSize and doubling each level. Stops early once a level no longer halves the triangle count. Returns the levels added
+inline unsigned int addLodChain(MeshBuilder& builder, const std::vector<MeshVertex>& triangles, float cellSize, unsigned int maxLevels)
+{
+    builder.beginLod();
+    for (const MeshVertex& vertex : triangles)
+        builder.addVertex(vertex);
+    unsigned int levels = 1;
+    size_t previousCount = triangles.size();
+    while (levels < maxLevels)
+    {
+        std::vector<MeshVertex> simplified = simplifyByClustering(triangles, cellSize);
+        if (simplified.empty() || simplified.size() * 2 > previousCount)
+            break;
+        builder.beginLod();
+        for (const MeshVertex& vertex : simplified)
+            builder.addVertex(vertex);
+        previousCount = simplified.size();
+        cellSize *= 2.0f;
+        levels++;
+    }
+    return levels;
+}
+
+//Picks a level of detail from an object's projected size. Each switch has a band around it an object has to cross before its
+//level changes, so objects sitting right at a switch don't flicker between two levels
+struct LodSelector
+{
+    unsigned int levels = 1;
+    //Projected diameter in pixels below which LOD 1 is used, each further level switches at half the size of the one before
+    float firstSwitchPixels = 160.0f;
+    //Fraction of a switch size an object has to get past it by
+    float hysteresis = 0.15f;
+
+    //Level for this frame given the level used last frame
+    unsigned int select(unsigned int previous, float pixels) const
+    {
+        unsigned int finest = levelFor(pixels * (1.0f + hysteresis));
+        unsigned int coarsest = levelFor(pixels * (1.0f - hysteresis));
+        return std::min(std::max(previous, finest), coarsest);
+    }
+
+    //Level without hysteresis
+    unsigned int levelFor(float pixels) const
+    {
+        unsigned int level = 0;
+        float size = firstSwitchPixels;
+        while (level + 1 < levels && pixels < size)
+        {
+            level++;
+            size *= 0.5f;
+        }
+        return level;
+    }
+
+    //Projected diameter in pixels of a bounding sphere at distance from the camera, for a vertical field of view in radians
+    static float projectedPixels(float radius, float distance, float fieldOfView, float screenHeight)
+    {
+        if (distance <= radius)
+            return FLT_MAX;
+        return radius / (distance * std::tan(fieldOfView * 0.5f)) * screenHeight;
+    }
+};
+
+#endif
@@ -0,0 +1,387 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "shader_s.h"
+#include "render_state.h"
+#include "fullscreen_triangle.h"
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cfloat>
+#include <iostream>
+
+//CPU copy of one hierarchical Z level read back from the GPU, with the coarser levels built from it here. Every texel holds
+//the farthest window space depth under it, so anything whose nearest point is farther than that is hidden behind drawn geometry
+struct DepthPyramid
+{
+    //Matrices the depth was rendered with. Tests use these rather than the current camera's, so a result is exact for the
+    //frame the depth came from and hidden objects show up again once a newer readback sees them
+    glm::mat4 view;
+    glm::mat4 projection;
+    //Size of the framebuffer the depth came from, level 0 texels cover (1 << shift) x (1 << shift) of its pixels
+    int screenWidth = 0;
+    int screenHeight = 0;
+    int shift = 0;
+    std::vector<std::vector<float>> levels;
+    std::vector<int> widths;
+    std::vector<int> heights;
+
+    //Max-reduce level 0 down to a single texel
+    void buildMips()
+    {
+        while (widths.back() > 1 || heights.back() > 1)
+        {
+            const std::vector<float>& source = levels.back();
+            int sourceWidth = widths.back();
+            int sourceHeight = heights.back();
+            int width = (sourceWidth + 1) / 2;
+            int height = (sourceHeight + 1) / 2;
+            std::vector<float> level(width * height);
+            for (int y = 0; y < height; y++)
+            {
+                int y0 = y * 2;
+                int y1 = std::min(y0 + 1, sourceHeight - 1);
+                for (int x = 0; x < width; x++)
+                {
+                    int x0 = x * 2;
+                    int x1 = std::min(x0 + 1, sourceWidth - 1);
+                    level[x + y * width] = std::max(std::max(source[x0 + y0 * sourceWidth], source[x1 + y0 * sourceWidth]),
+                        std::max(source[x0 + y1 * sourceWidth], source[x1 + y1 * sourceWidth]));
+                }
+            }
+            levels.push_back(std::move(level));
+            widths.push_back(width);
+            heights.push_back(height);
+        }
+    }
+
+    //True if a bounding sphere is completely behind the stored depth. Spheres crossing the near plane or the screen edge never are.
+    //The sphere's projected box is looked up on the level where it spans at most two texels each way, so one test is a few reads
+    bool occluded(const glm::vec3& position, float radius) const
+    {
+        glm::vec4 center = view * glm::vec4(position, 1.0f);
+        float closest = -center.z - radius;
+        if (closest <= 0.0f)
+            return false;
+        //Window space depth of the sphere's nearest point, same mapping as the projection and glDepthRange(0, 1)
+        float nearestDepth = (projection[2][2] * -closest + projection[3][2]) / closest * 0.5f + 0.5f;
+        if (nearestDepth <= 0.0f)
+            return false;
+        //x / depth is monotonic over the view space box, so its corners at the nearest and farthest depth bound it on screen
+        float minX = FLT_MAX, maxX = -FLT_MAX, minY = FLT_MAX, maxY = -FLT_MAX;
+        float depths[2] = { closest, -center.z + radius };
+        for (float d : depths)
+        {
+            for (int side = -1; side <= 1; side += 2)
+            {
+                float x = projection[0][0] * (center.x + side * radius) / d;
+                float y = projection[1][1] * (center.y + side * radius) / d;
+                minX = std::min(minX, x);
+                maxX = std::max(maxX, x);
+                minY = std::min(minY, y);
+                maxY = std::max(maxY, y);
+            }
+        }
+        if (minX < -1.0f || maxX > 1.0f || minY < -1.0f || maxY > 1.0f)
+            return false;
+        int x0 = pixel(minX, screenWidth) >> shift;
+        int x1 = pixel(maxX, screenWidth) >> shift;
+        int y0 = pixel(minY, screenHeight) >> shift;
+        int y1 = pixel(maxY, screenHeight) >> shift;
+        unsigned int level = 0;
+        while (level + 1 < levels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+            level++;
+        const std::vector<float>& depth = levels[level];
+        int width = widths[level];
+        int height = heights[level];
+        for (int y = y0 >> level; y <= (y1 >> level); y++)
+        {
+            for (int x = x0 >> level; x <= (x1 >> level); x++)
+            {
+                if (nearestDepth <= depth[std::min(x, width - 1) + std::min(y, height - 1) * width])
+                    return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    static int pixel(float ndc, int size)
+    {
+        int index = (int)std::floor((ndc * 0.5f + 0.5f) * size);
+        return std::min(std::max(index, 0), size - 1);
+    }
+};
+
+//Hierarchical Z built on the GPU from a finished frame's depth. The depth buffer is copied into a texture, max-reduced by
+//fullscreen.vs/hiz.fs a level at a time until it's at most READBACK_WIDTH wide, and that level is read back through a ring of
+//fenced pixel pack buffers. collect() hands out whichever readback finished last, so nothing here ever waits on the GPU.
+//The levels are sized for the whole source framebuffer and only its rendered corner is reduced, so the render scale can
+//change every frame without reallocating them or dropping readbacks
+class HiZBuffer
+{
+public:
+    static const int READBACK_WIDTH = 128;
+    static const unsigned int READBACKS = 3;
+
+    Shader shader;
+
+    HiZBuffer() : shader("fullscreen.vs", "hiz.fs")
+    {
+        sourceSizeUniform = shader.uniform("sourceSize");
+        glUseProgram(shader.shaderProgram);
+        shader.setInt("source", 0);
+        glUseProgram(0);
+        for (unsigned int i = 0; i < READBACKS; i++)
+            glGenBuffers(1, &readbacks[i].buffer);
+    }
+
+    //Reduce the width x height corner of the depth just drawn into sourceFramebuffer, which is sourceWidth x sourceHeight, and
+    //start reading it back. The caller's framebuffer is bound again afterwards with a width x height viewport
+    void build(RenderState& state, unsigned int sourceFramebuffer, int sourceWidth, int sourceHeight, int width, int height, const glm::mat4& view, const glm::mat4& projection)
+    {
+        if (sourceWidth != storageWidth || sourceHeight != storageHeight)
+        {
+            //Creating the levels binds textures and buffers directly
+            resize(sourceWidth, sourceHeight);
+            state.invalidate();
+            glBindFramebuffer(GL_FRAMEBUFFER, sourceFramebuffer);
+        }
+        if (levelFramebuffers.empty() || width > storageWidth || height > storageHeight)
+            return;
+        //Blit instead of sampling the depth buffer directly, the window's default framebuffer can't be bound as a texture
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, sourceFramebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, depthFramebuffer);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+        state.setEnabled(GL_DEPTH_TEST, false);
+        state.setEnabled(GL_BLEND, false);
+        state.colorMask(true);
+        state.useProgram(shader.shaderProgram);
+        //Same rounding as the levels themselves, so the corner of every level lines up with the corner of the depth
+        unsigned int source = depthTexture;
+        int levelWidth = width;
+        int levelHeight = height;
+        for (size_t i = 0; i < levelFramebuffers.size(); i++)
+        {
+            shader.setVec2(sourceSizeUniform, glm::vec2((float)levelWidth, (float)levelHeight));
+            levelWidth = (levelWidth + 1) / 2;
+            levelHeight = (levelHeight + 1) / 2;
+            glBindFramebuffer(GL_FRAMEBUFFER, levelFramebuffers[i]);
+            glViewport(0, 0, levelWidth, levelHeight);
+            state.bindTexture(0, source);
+            triangle.draw(state);
+            source = levelTextures[i];
+        }
+
+        //A slot whose last readback hasn't landed yet is left alone, this frame just isn't read back
+        Readback& readback = readbacks[nextReadback];
+        if (!readback.fence)
+        {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, levelFramebuffers.back());
+            state.bindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+            glReadPixels(0, 0, levelWidth, levelHeight, GL_RED, GL_FLOAT, (void*)0);
+            state.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            readback.serial = ++readbackSerial;
+            readback.screenWidth = width;
+            readback.screenHeight = height;
+            readback.width = levelWidth;
+            readback.height = levelHeight;
+            readback.view = view;
+            readback.projection = projection;
+            nextReadback = (nextReadback + 1) % READBACKS;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, sourceFramebuffer);
+        glViewport(0, 0, width, height);
+    }
+
+    //Newest readback the GPU has finished, or the last one returned if none finished since. Null until the first lands
+    std::shared_ptr<const DepthPyramid> collect(RenderState& state)
+    {
+        Readback* newest = nullptr;
+        for (unsigned int i = 0; i < READBACKS; i++)
+        {
+            Readback& readback = readbacks[i];
+            if (!readback.fence)
+                continue;
+            GLenum status = glClientWaitSync(readback.fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                continue;
+            glDeleteSync(readback.fence);
+            readback.fence = 0;
+            if (!newest || readback.serial > newest->serial)
+                newest = &readback;
+        }
+        if (!newest)
+            return latest;
+        std::shared_ptr<DepthPyramid> pyramid = std::make_shared<DepthPyramid>();
+        pyramid->view = newest->view;
+        pyramid->projection = newest->projection;
+        pyramid->screenWidth = newest->screenWidth;
+        pyramid->screenHeight = newest->screenHeight;
+        pyramid->shift = (int)levelFramebuffers.size();
+        pyramid->widths.push_back(newest->width);
+        pyramid->heights.push_back(newest->height);
+        pyramid->levels.push_back(std::vector<float>(newest->width * newest->height));
+        state.bindBuffer(GL_PIXEL_PACK_BUFFER, newest->buffer);
+        void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, pyramid->levels[0].size() * sizeof(float), GL_MAP_READ_BIT);
+        if (mapped)
+        {
+            std::memcpy(pyramid->levels[0].data(), mapped, pyramid->levels[0].size() * sizeof(float));
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        state.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        if (!mapped)
+            return latest;
+        pyramid->buildMips();
+        latest = pyramid;
+        return latest;
+    }
+
+    //Forget every readback, finished or not, so a stale view is never tested against once culling is turned back on
+    void reset()
+    {
+        for (unsigned int i = 0; i < READBACKS; i++)
+        {
+            if (readbacks[i].fence)
+                glDeleteSync(readbacks[i].fence);
+            readbacks[i].fence = 0;
+        }
+        latest.reset();
+    }
+
+    void destroy()
+    {
+        destroyLevels();
+        reset();
+        for (unsigned int i = 0; i < READBACKS; i++)
+            glDeleteBuffers(1, &readbacks[i].buffer);
+        triangle.destroy();
+        glDeleteProgram(shader.shaderProgram);
+    }
+
+private:
+    struct Readback
+    {
+        unsigned int buffer = 0;
+        GLsync fence = 0;
+        unsigned long long serial = 0;
+        //Rendered size the depth came from and the part of the last level it reduced to, at most the buffer's size
+        int screenWidth = 0;
+        int screenHeight = 0;
+        int width = 0;
+        int height = 0;
+        glm::mat4 view;
+        glm::mat4 projection;
+    };
+    FullScreenTriangle triangle;
+    UniformHandle sourceSizeUniform;
+    unsigned int depthTexture = 0;
+    unsigned int depthFramebuffer = 0;
+    //Each reduction level gets its own R32F texture, so no pass ever reads the texture it's drawing into
+    std::vector<unsigned int> levelTextures;
+    std::vector<unsigned int> levelFramebuffers;
+    std::vector<int> levelWidths;
+    std::vector<int> levelHeights;
+    //Size of the source framebuffer the levels were made for
+    int storageWidth = 0;
+    int storageHeight = 0;
+    Readback readbacks[READBACKS];
+    unsigned int nextReadback = 0;
+    unsigned long long readbackSerial = 0;
+    std::shared_ptr<const DepthPyramid> latest;
+
+    //Depth copy at full size, then halved levels rounded up until one is at most READBACK_WIDTH wide
+    void resize(int width, int height)
+    {
+        destroyLevels();
+        storageWidth = width;
+        storageHeight = height;
+        //Readbacks still in flight were sized for the old levels and their buffers are about to be reallocated, drop them
+        reset();
+        if (width <= 0 || height <= 0)
+            return;
+        //Same format as the window's and RenderTarget's depth buffers, depth blits need the formats to match
+        glGenTextures(1, &depthTexture);
+        glBindTexture(GL_TEXTURE_2D, depthTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+        setNearestFiltering();
+        glGenFramebuffers(1, &depthFramebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, depthFramebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+        int levelWidth = width;
+        int levelHeight = height;
+        while (complete && (levelWidths.empty() || levelWidth > READBACK_WIDTH))
+        {
+            levelWidth = (levelWidth + 1) / 2;
+            levelHeight = (levelHeight + 1) / 2;
+            unsigned int texture;
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, levelWidth, levelHeight, 0, GL_RED, GL_FLOAT, NULL);
+            setNearestFiltering();
+            unsigned int framebuffer;
+            glGenFramebuffers(1, &framebuffer);
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+            complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+            levelTextures.push_back(texture);
+            levelFramebuffers.push_back(framebuffer);
+            levelWidths.push_back(levelWidth);
+            levelHeights.push_back(levelHeight);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (!complete)
+        {
+            std::cout << "ERROR::HIZ::FRAMEBUFFER_INCOMPLETE" << std::endl;
+            destroyLevels();
+            return;
+        }
+        for (unsigned int i = 0; i < READBACKS; i++)
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, readbacks[i].buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, levelWidth * levelHeight * sizeof(float), NULL, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    void destroyLevels()
+    {
+        if (!levelTextures.empty())
+            glDeleteTextures((GLsizei)levelTextures.size(), levelTextures.data());
+        if (!levelFramebuffers.empty())
+            glDeleteFramebuffers((GLsizei)levelFramebuffers.size(), levelFramebuffers.data());
+        if (depthTexture)
+            glDeleteTextures(1, &depthTexture);
+        if (depthFramebuffer)
+            glDeleteFramebuffers(1, &depthFramebuffer);
+        levelTextures.clear();
+        levelFramebuffers.clear();
+        levelWidths.clear();
+        levelHeights.clear();
+        depthTexture = 0;
+        depthFramebuffer = 0;
+    }
+
+    //texelFetch ignores filtering, but a mipmapping min filter would leave the single level textures incomplete
+    static void setNearestFiltering()
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+};
+
+#endif
@@ -0,0 +1,11 @@
+#version 330 core
+layout (location = 0) in vec2 aPos;
+
+//Viewport size in pixels, positions come in as pixels from the top left corner
+uniform vec2 screenSize;
+
+void main()
+{
+    vec2 ndc = aPos / screenSize * 2.0 - 1.0;
+    gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+}
@@ -0,0 +1,348 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+
+//CPU and GPU timings for named sections of a frame. GPU times come from GL_TIMESTAMP queries kept in a
+//ring of LATENCY frames and are only read back once the frame that wrote them comes round again, so nothing stalls
+class Profiler
+{
+public:
+    static const unsigned int LATENCY = 4;
+    //Samples per section for the rolling averages
+    static const unsigned int WINDOW = 120;
+    //Completed frames kept for the Chrome trace
+    static const unsigned int TRACE_FRAMES = 600;
+
+    //Rolling statistics for one section, -1 GPU time means no result yet
+    struct SectionStats
+    {
+        std::string name;
+        int depth = 0;
+        double cpuAverage = 0.0;
+        double cpuMax = 0.0;
+        double gpuAverage = -1.0;
+        double gpuMax = -1.0;
+    };
+
+    Profiler()
+    {
+        epoch = std::chrono::steady_clock::now();
+    }
+
+    //Needs a current GL context, sets up the CPU/GPU clock alignment for traces
+    void init()
+    {
+        GLint64 gpuNow = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        gpuToCpuOffset = cpuNow() - gpuNow / 1000.0;
+        initialized = true;
+    }
+
+    void beginFrame()
+    {
+        FrameSlot& slot = slots[frame % LATENCY];
+        //This slot was last written LATENCY frames ago, its queries should be done by now
+        if (slot.used)
+            resolve(slot);
+        slot.sections.clear();
+        slot.queriesUsed = 0;
+        slot.used = true;
+        slot.frame = frame;
+        depth = 0;
+    }
+
+    void endFrame()
+    {
+        frame++;
+    }
+
+    //Fold in every frame still waiting on its queries, oldest first. Call after glFinish so the GPU times are all there
+    void flush()
+    {
+        while (true)
+        {
+            FrameSlot* oldest = nullptr;
+            for (FrameSlot& slot : slots)
+            {
+                if (slot.used && (!oldest || slot.frame < oldest->frame))
+                    oldest = &slot;
+            }
+            if (!oldest)
+                break;
+            resolve(*oldest);
+            oldest->sections.clear();
+            oldest->used = false;
+        }
+    }
+
+    //Returns the section's index for endSection, sections may nest
+    unsigned int beginSection(const char* name)
+    {
+        FrameSlot& slot = slots[frame % LATENCY];
+        SectionRecord record;
+        record.name = name;
+        record.depth = depth++;
+        record.cpuStart = cpuNow();
+        record.startQuery = nextQuery(slot);
+        glQueryCounter(record.startQuery, GL_TIMESTAMP);
+        slot.sections.push_back(record);
+        return (unsigned int)slot.sections.size() - 1;
+    }
+
+    void endSection(unsigned int index)
+    {
+        FrameSlot& slot = slots[frame % LATENCY];
+        SectionRecord& record = slot.sections[index];
+        record.endQuery = nextQuery(slot);
+        glQueryCounter(record.endQuery, GL_TIMESTAMP);
+        record.cpuEnd = cpuNow();
+        depth--;
+    }
+
+    //Rolling stats in the order sections were first seen
+    std::vector<SectionStats> stats() const
+    {
+        std::vector<SectionStats> result;
+        for (const SectionHistory& history : histories)
+        {
+            SectionStats entry;
+            entry.name = history.name;
+            entry.depth = history.depth;
+            summarize(history.cpu, entry.cpuAverage, entry.cpuMax);
+            if (!history.gpu.empty())
+                summarize(history.gpu, entry.gpuAverage, entry.gpuMax);
+            result.push_back(entry);
+        }
+        return result;
+    }
+
+    //One line per section, for the overlay or the console
+    std::string overlayText() const
+    {
+        std::ostringstream text;
+        text << std::fixed << std::setprecision(2);
+        text << "SECTION            CPU MS    GPU MS\n";
+        for (const SectionStats& entry : stats())
+        {
+            std::string label = std::string(entry.depth * 2, ' ') + entry.name;
+            text << std::left << std::setw(18) << label << " " << std::right << std::setw(6) << entry.cpuAverage << "    ";
+            if (entry.gpuAverage >= 0.0)
+                text << std::setw(6) << entry.gpuAverage;
+            else
+                text << "     -";
+            text << "\n";
+        }
+        return text.str();
+    }
+
+    //Chrome trace event format, open with chrome://tracing or ui.perfetto.dev. CPU sections on thread 1, GPU on thread 2
+    bool writeChromeTrace(const std::string& path) const
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::PROFILER::FAILED_TO_WRITE " << path << std::endl;
+            return false;
+        }
+        file << std::fixed << std::setprecision(3);
+        file << "{\"traceEvents\":[\n";
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+        for (const TraceEvent& event : trace)
+        {
+            file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+                << ",\"ts\":" << event.start << ",\"dur\":" << event.duration << ",\"args\":{\"frame\":" << event.frame << "}}";
+        }
+        file << "\n]}\n";
+        std::cout << "Wrote profiler trace of " << trace.size() << " events to " << path << std::endl;
+        return true;
+    }
+
+    //Query objects of every slot, delete on shutdown
+    std::vector<unsigned int> allQueries() const
+    {
+        std::vector<unsigned int> result;
+        for (const FrameSlot& slot : slots)
+            result.insert(result.end(), slot.queries.begin(), slot.queries.end());
+        return result;
+    }
+
+private:
+    struct SectionRecord
+    {
+        const char* name;
+        int depth;
+        double cpuStart;
+        double cpuEnd;
+        unsigned int startQuery;
+        unsigned int endQuery;
+    };
+    struct FrameSlot
+    {
+        std::vector<SectionRecord> sections;
+        std::vector<unsigned int> queries;
+        unsigned int queriesUsed = 0;
+        unsigned long long frame = 0;
+        bool used = false;
+    };
+    struct SectionHistory
+    {
+        std::string name;
+        int depth;
+        std::deque<double> cpu;
+        std::deque<double> gpu;
+    };
+    struct TraceEvent
+    {
+        std::string name;
+        int thread;
+        //Microseconds since the profiler was created
+        double start;
+        double duration;
+        unsigned long long frame;
+    };
+
+    FrameSlot slots[LATENCY];
+    std::vector<SectionHistory> histories;
+    std::deque<TraceEvent> trace;
+    std::deque<unsigned long long> traceFrameSizes;
+    std::chrono::steady_clock::time_point epoch;
+    double gpuToCpuOffset = 0.0;
+    bool initialized = false;
+    unsigned long long frame = 0;
+    int depth = 0;
+
+    //Microseconds since construction
+    double cpuNow() const
+    {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    unsigned int nextQuery(FrameSlot& slot)
+    {
+        if (slot.queriesUsed == slot.queries.size())
+        {
+            unsigned int query;
+            glGenQueries(1, &query);
+            slot.queries.push_back(query);
+        }
+        return slot.queries[slot.queriesUsed++];
+    }
+
+    //Fold a finished frame into the rolling stats and the trace
+    void resolve(FrameSlot& slot)
+    {
+        bool gpuReady = false;
+        if (!slot.sections.empty())
+        {
+            //Queries complete in order, so if the last one is done they all are
+            int available = 0;
+            glGetQueryObjectiv(slot.sections.back().endQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+            gpuReady = available != 0;
+        }
+        unsigned long long events = 0;
+        for (const SectionRecord& record : slot.sections)
+        {
+            SectionHistory& history = historyFor(record.name, record.depth);
+            double cpuMilliseconds = (record.cpuEnd - record.cpuStart) / 1000.0;
+            push(history.cpu, cpuMilliseconds);
+            addTraceEvent(record.name, 1, record.cpuStart, record.cpuEnd - record.cpuStart, slot.frame);
+            events++;
+            if (gpuReady)
+            {
+                GLuint64 start = 0;
+                GLuint64 end = 0;
+                glGetQueryObjectui64v(record.startQuery, GL_QUERY_RESULT, &start);
+                glGetQueryObjectui64v(record.endQuery, GL_QUERY_RESULT, &end);
+                push(history.gpu, (end - start) / 1000000.0);
+                if (initialized)
+                {
+                    addTraceEvent(record.name, 2, start / 1000.0 + gpuToCpuOffset, (end - start) / 1000.0, slot.frame);
+                    events++;
+                }
+            }
+        }
+        traceFrameSizes.push_back(events);
+        while (traceFrameSizes.size() > TRACE_FRAMES)
+        {
+            for (unsigned long long i = 0; i < traceFrameSizes.front(); i++)
+                trace.pop_front();
+            traceFrameSizes.pop_front();
+        }
+    }
+
+    SectionHistory& historyFor(const char* name, int sectionDepth)
+    {
+        for (SectionHistory& history : histories)
+        {
+            if (history.name == name)
+                return history;
+        }
+        SectionHistory history;
+        history.name = name;
+        history.depth = sectionDepth;
+        histories.push_back(history);
+        return histories.back();
+    }
+
+    void addTraceEvent(const char* name, int thread, double start, double duration, unsigned long long eventFrame)
+    {
+        TraceEvent event;
+        event.name = name;
+        event.thread = thread;
+        event.start = start;
+        event.duration = duration;
+        event.frame = eventFrame;
+        trace.push_back(event);
+    }
+
+    static void push(std::deque<double>& samples, double value)
+    {
+        samples.push_back(value);
+        if (samples.size() > WINDOW)
+            samples.pop_front();
+    }
+
+    static void summarize(const std::deque<double>& samples, double& average, double& maximum)
+    {
+        average = 0.0;
+        maximum = 0.0;
+        for (double sample : samples)
+        {
+            average += sample;
+            maximum = std::max(maximum, sample);
+        }
+        if (!samples.empty())
+            average /= samples.size();
+    }
+};
+
+//Times everything from construction to the end of the enclosing block
+class ProfileScope
+{
+public:
+    ProfileScope(Profiler& profiler, const char* name) : profiler(profiler), index(profiler.beginSection(name)) {}
+    ~ProfileScope()
+    {
+        profiler.endSection(index);
+    }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    Profiler& profiler;
+    unsigned int index;
+};
+
+#endif
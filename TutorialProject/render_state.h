@@ -0,0 +1,223 @@
+#ifndef RENDER_STATE_H
+#define RENDER_STATE_H
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+
+//Calls made and skipped through a RenderState
+struct RenderStateStats
+{
+    unsigned long long calls = 0;
+    unsigned long long skipped = 0;
+};
+
+//Shadow copy of the GL bindings the render loop touches. Calls that wouldn't change anything are skipped.
+//Anything binding behind its back has to put the old binding back or call invalidate()
+class RenderState
+{
+public:
+    static const unsigned int TEXTURE_UNITS = 16;
+    RenderStateStats stats;
+
+    RenderState()
+    {
+        invalidate();
+    }
+
+    //Forget everything, the next call of each kind always goes through
+    void invalidate()
+    {
+        program = UNKNOWN;
+        vertexArray = UNKNOWN;
+        activeUnit = UNKNOWN;
+        for (unsigned int i = 0; i < TEXTURE_UNITS; i++)
+            textures[i] = UNKNOWN;
+        buffers.clear();
+        capabilities.clear();
+        blendSource = UNKNOWN;
+        blendDestination = UNKNOWN;
+        depthFunction = UNKNOWN;
+        depthWrites = UNKNOWN;
+        colorWrites = UNKNOWN;
+    }
+
+    void useProgram(unsigned int newProgram)
+    {
+        if (skip(program == newProgram))
+            return;
+        glUseProgram(newProgram);
+        program = newProgram;
+    }
+
+    void bindVertexArray(unsigned int newVertexArray)
+    {
+        if (skip(vertexArray == newVertexArray))
+            return;
+        glBindVertexArray(newVertexArray);
+        vertexArray = newVertexArray;
+    }
+
+    //2D texture on a unit, only switches the active unit when the binding actually changes
+    void bindTexture(unsigned int unit, unsigned int texture)
+    {
+        if (skip(textures[unit] == texture))
+            return;
+        if (!skip(activeUnit == unit))
+        {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            activeUnit = unit;
+        }
+        glBindTexture(GL_TEXTURE_2D, texture);
+        textures[unit] = texture;
+    }
+
+    //Non-indexed buffer targets. GL_ELEMENT_ARRAY_BUFFER belongs to the bound VAO, leave that one to the VAO
+    void bindBuffer(GLenum target, unsigned int buffer)
+    {
+        unsigned int& bound = lookup(buffers, target);
+        if (skip(bound == buffer))
+            return;
+        glBindBuffer(target, buffer);
+        bound = buffer;
+    }
+
+    void setEnabled(GLenum capability, bool enabled)
+    {
+        unsigned int& current = lookup(capabilities, capability);
+        unsigned int wanted = enabled ? 1 : 0;
+        if (skip(current == wanted))
+            return;
+        if (enabled)
+            glEnable(capability);
+        else
+            glDisable(capability);
+        current = wanted;
+    }
+
+    void blendFunc(GLenum source, GLenum destination)
+    {
+        if (skip(blendSource == source && blendDestination == destination))
+            return;
+        glBlendFunc(source, destination);
+        blendSource = source;
+        blendDestination = destination;
+    }
+
+    void depthFunc(GLenum function)
+    {
+        if (skip(depthFunction == function))
+            return;
+        glDepthFunc(function);
+        depthFunction = function;
+    }
+
+    //Also has to be on for glClear to clear depth
+    void depthMask(bool enabled)
+    {
+        unsigned int wanted = enabled ? 1 : 0;
+        if (skip(depthWrites == wanted))
+            return;
+        glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+        depthWrites = wanted;
+    }
+
+    //All four channels at once
+    void colorMask(bool enabled)
+    {
+        unsigned int wanted = enabled ? 1 : 0;
+        if (skip(colorWrites == wanted))
+            return;
+        GLboolean mask = enabled ? GL_TRUE : GL_FALSE;
+        glColorMask(mask, mask, mask, mask);
+        colorWrites = wanted;
+    }
+
+private:
+    static const unsigned int UNKNOWN = 0xFFFFFFFFu;
+    unsigned int program;
+    unsigned int vertexArray;
+    unsigned int activeUnit;
+    unsigned int textures[TEXTURE_UNITS];
+    unsigned int blendSource;
+    unsigned int blendDestination;
+    unsigned int depthFunction;
+    unsigned int depthWrites;
+    unsigned int colorWrites;
+    //Small (key, value) lists, only a handful of targets and capabilities are ever used
+    std::vector<std::pair<GLenum, unsigned int>> buffers;
+    std::vector<std::pair<GLenum, unsigned int>> capabilities;
+
+    bool skip(bool redundant)
+    {
+        stats.calls++;
+        if (redundant)
+            stats.skipped++;
+        return redundant;
+    }
+
+    static unsigned int& lookup(std::vector<std::pair<GLenum, unsigned int>>& values, GLenum key)
+    {
+        for (std::pair<GLenum, unsigned int>& value : values)
+        {
+            if (value.first == key)
+                return value.second;
+        }
+        values.push_back(std::make_pair(key, UNKNOWN));
+        return values.back().second;
+    }
+};
+
+//Sort key, most expensive state change in the highest bits: program, then texture set, then VAO, then depth front to back.
+//Program, texture set and VAO are small ids, depth is 0 at the camera and 1 at the far plane
+inline std::uint64_t drawSortKey(unsigned int program, unsigned int textureSet, unsigned int vertexArray, float depth)
+{
+    depth = std::min(std::max(depth, 0.0f), 1.0f);
+    std::uint64_t quantizedDepth = (std::uint64_t)(depth * 0xFFFFFF);
+    return ((std::uint64_t)(program & 0xFFF) << 52) | ((std::uint64_t)(textureSet & 0xFFFF) << 36)
+        | ((std::uint64_t)(vertexArray & 0xFFF) << 24) | quantizedDepth;
+}
+
+//One entry in a RenderQueue. The queue binds the program, textures and VAO, draw() sets uniforms and issues the draw calls
+struct DrawItem
+{
+    std::uint64_t key = 0;
+    unsigned int program = 0;
+    unsigned int vertexArray = 0;
+    //Bound to units 0..textureCount-1
+    unsigned int textures[4] = {};
+    unsigned int textureCount = 0;
+    std::function<void()> draw;
+};
+
+//Draws collected over a frame, submitted in sort key order so items sharing state end up next to each other
+class RenderQueue
+{
+public:
+    void add(DrawItem item)
+    {
+        items.push_back(std::move(item));
+    }
+
+    void submit(RenderState& state)
+    {
+        std::stable_sort(items.begin(), items.end(), [](const DrawItem& a, const DrawItem& b) { return a.key < b.key; });
+        for (DrawItem& item : items)
+        {
+            state.useProgram(item.program);
+            for (unsigned int i = 0; i < item.textureCount; i++)
+                state.bindTexture(i, item.textures[i]);
+            state.bindVertexArray(item.vertexArray);
+            item.draw();
+        }
+        items.clear();
+    }
+
+private:
+    std::vector<DrawItem> items;
+};
+
+#endif
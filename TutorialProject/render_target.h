@@ -0,0 +1,78 @@
+#ifndef RENDER_TARGET_H
+#define RENDER_TARGET_H
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+//Offscreen framebuffer with a sampleable color texture and a depth renderbuffer
+class RenderTarget
+{
+public:
+    unsigned int framebuffer = 0;
+    unsigned int colorTexture = 0;
+    unsigned int depthRenderbuffer = 0;
+    int width = 0;
+    int height = 0;
+
+    //Create or re-create the attachments at the given size
+    bool create(int newWidth, int newHeight)
+    {
+        destroy();
+        width = newWidth;
+        height = newHeight;
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+        glGenTextures(1, &colorTexture);
+        glBindTexture(GL_TEXTURE_2D, colorTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+
+        glGenRenderbuffers(1, &depthRenderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        if (!complete)
+            std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return complete;
+    }
+
+    void destroy()
+    {
+        if (framebuffer)
+            glDeleteFramebuffers(1, &framebuffer);
+        if (colorTexture)
+            glDeleteTextures(1, &colorTexture);
+        if (depthRenderbuffer)
+            glDeleteRenderbuffers(1, &depthRenderbuffer);
+        framebuffer = 0;
+        colorTexture = 0;
+        depthRenderbuffer = 0;
+    }
+
+    //Bind for drawing and match the viewport to it
+    void bind() const
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glViewport(0, 0, width, height);
+    }
+
+    //Bind for drawing into just the bottom left viewportWidth x viewportHeight corner
+    void bind(int viewportWidth, int viewportHeight) const
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glViewport(0, 0, viewportWidth, viewportHeight);
+    }
+};
+
+#endif
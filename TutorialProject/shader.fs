@@ -1,39 +1,87 @@
 #version 330 core
+//Permutations, defined by Shader right after this line for the features a draw doesn't use:
+//NO_TEXTURE1 / NO_TEXTURE2 sample only the other layer, NO_VERTEX_COLOR drops the vertex color, SPECULAR_OFF drops specular,
+//SINGLE_LIGHT lights with the FrameData light alone instead of looking up the light grid
+#ifndef SHININESS
+#define SHININESS 32.0
+#endif
 out vec4 FragColor;
 
 in vec2 texCoord;
+#ifndef NO_VERTEX_COLOR
 in vec3 objectColor;
+#endif
 in vec3 normal;
 in vec3 fragPos;
+flat in int materialIndex;
 
-uniform sampler2D texture1;
-uniform sampler2D texture2;
-uniform float mixValue;
+//Every texture, one per layer
+uniform sampler2DArray textures;
+//Two texels per material written by MaterialTable: (layer1, layer2, mix, 0) and (ambient, specular, 0, 0)
+uniform samplerBuffer materials;
+#ifndef SINGLE_LIGHT
+//Lights and per cluster light lists packed by LightGrid, floats stored as bits
+uniform usamplerBuffer lightGrid;
+#endif
 
-uniform float ambientLightStrength;
-uniform float specularLightStrength;
+//FrameData (camera and light data, written once per frame by main()) is inserted by Shader, see FRAME_DATA_GLSL
+//Its lightStrengths go unused here, ambient and specular strength come from the material
 
-uniform vec3 lightColor;
-uniform vec3 lightPos;
-uniform vec3 viewPos;
-
-void main()
+//Diffuse plus specular from one light
+vec3 shade(vec3 norm, vec3 position, vec3 color, float specularStrength)
 {
-    vec3 norm = normalize(normal);
-    vec3 lightDirection = normalize(lightPos - fragPos);
+    vec3 lightDirection = normalize(position - fragPos);
     float diff = max(dot(norm, lightDirection), 0.0);
-    vec3 diffuse = diff * lightColor;
-
-    vec3 ambient = ambientLightStrength * lightColor;
-
-    vec3 viewDirection = normalize(viewPos - fragPos);
+    vec3 light = diff * color;
+#ifndef SPECULAR_OFF
+    vec3 viewDirection = normalize(cameraPosition.xyz - fragPos);
     vec3 reflectDirection = reflect(-lightDirection, norm);
-    float spec = pow(max(dot(viewDirection, reflectDirection), 0.0), 32);
-    vec3 specular = specularLightStrength * spec * lightColor;
+    float spec = pow(max(dot(viewDirection, reflectDirection), 0.0), SHININESS);
+    light += specularStrength * spec * color;
+#endif
+    return light;
+}
 
-    vec3 lightSum = ambient + diffuse + specular;
+void main()
+{
+    vec4 layers = texelFetch(materials, materialIndex * 2);
+    vec4 strengths = texelFetch(materials, materialIndex * 2 + 1);
+    vec3 norm = normalize(normal);
+    vec3 ambient = strengths.x * lightColor.rgb;
+    vec3 lightSum = ambient;
+#ifdef SINGLE_LIGHT
+    lightSum += shade(norm, lightPosition.xyz, lightColor.rgb, strengths.y);
+#else
+    //Same cluster LightGrid put this fragment's lights in: screen tile from clip space, slice from view depth (clip w)
+    vec4 clip = viewProjection * vec4(fragPos, 1.0);
+    ivec2 tile = ivec2(clamp((clip.xy / clip.w * 0.5 + 0.5) * clusterGrid.xy, vec2(0.0), clusterGrid.xy - 1.0));
+    int slice = int(clamp(log(clip.w / clusterDepth.x) * clusterDepth.y, 0.0, clusterGrid.z - 1.0));
+    int cluster = tile.x + int(clusterGrid.x) * (tile.y + int(clusterGrid.y) * slice);
+    uvec4 header = texelFetch(lightGrid, int(lightOffsets.y) + cluster);
+    for (uint i = 0u; i < header.y; i++)
+    {
+        uint item = header.x + i;
+        int light = int(texelFetch(lightGrid, int(lightOffsets.z) + int(item / 4u))[item % 4u]);
+        vec4 positionRadius = uintBitsToFloat(texelFetch(lightGrid, int(lightOffsets.x) + light * 2));
+        vec3 color = uintBitsToFloat(texelFetch(lightGrid, int(lightOffsets.x) + light * 2 + 1)).rgb;
+        //Smooth falloff reaching 0 at the radius, so lights left out of a cluster contribute nothing there anyway
+        float ratio = length(positionRadius.xyz - fragPos) / positionRadius.w;
+        float falloff = clamp(1.0 - ratio * ratio, 0.0, 1.0);
+        lightSum += shade(norm, positionRadius.xyz, color, strengths.y) * falloff * falloff;
+    }
+#endif
 
     vec2 someVec = vec2(-texCoord.x, texCoord.y);
+#if defined(NO_TEXTURE1)
+    vec4 surface = texture(textures, vec3(someVec, layers.y));
+#elif defined(NO_TEXTURE2)
+    vec4 surface = texture(textures, vec3(texCoord, layers.x));
+#else
+    vec4 surface = mix(texture(textures, vec3(texCoord, layers.x)), texture(textures, vec3(someVec, layers.y)), layers.z);
+#endif
+#ifndef NO_VERTEX_COLOR
+    surface *= vec4(objectColor, 1.0);
+#endif
 
-    FragColor = vec4(lightSum, 1.0) * (vec4(objectColor, 1.0) * mix(texture(texture1, texCoord), texture(texture2, someVec), mixValue));
+    FragColor = vec4(lightSum, 1.0) * surface;
 }
\ No newline at end of file
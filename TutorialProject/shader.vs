@@ -1,24 +1,48 @@
 #version 330 core
+//Normal matrix comes from the CPU (uniform or per instance attribute), comment out to invert per vertex instead
+#define CPU_NORMAL_MATRIX
+
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
 layout (location = 2) in vec3 aColor;
 layout (location = 3) in vec3 aNormal;
+//Per instance model, normal matrix and material index, only read when drawing instanced
+layout (location = 4) in mat4 aInstanceModel;
+layout (location = 8) in mat3 aInstanceNormalMatrix;
+layout (location = 11) in uint aInstanceMaterial;
 
+#ifndef NO_VERTEX_COLOR
 out vec3 objectColor;
+#endif
 out vec2 texCoord;
 out vec3 fragPos;
 out vec3 normal;
+flat out int materialIndex;
+
+//FrameData (camera and light data, written once per frame by main()) is inserted by Shader, see FRAME_DATA_GLSL
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform mat3 normalMatrix;
+uniform bool instanced;
+uniform int material;
+
+//Same as depth.vs, so the depth pre-pass and this pass produce bit identical depth
+invariant gl_Position;
 
 void main()
 {
-   gl_Position = projection * view * model * vec4(aPos, 1.0);
+   mat4 modelMatrix = instanced ? aInstanceModel : model;
+   gl_Position = viewProjection * modelMatrix * vec4(aPos, 1.0);
    texCoord = aTexCoord;
+   materialIndex = instanced ? int(aInstanceMaterial) : material;
+#ifndef NO_VERTEX_COLOR
    objectColor = aColor;
-   //Inefficient to do inverse here, should generally do this in main program, but fine for this project
-   normal = mat3(transpose(inverse(model))) * aNormal;
-   fragPos = vec3(model * vec4(aPos, 1.0));  
+#endif
+#ifdef CPU_NORMAL_MATRIX
+   normal = (instanced ? aInstanceNormalMatrix : normalMatrix) * aNormal;
+#else
+   //Inefficient to do inverse here, kept to measure against the CPU computed normal matrix
+   normal = mat3(transpose(inverse(modelMatrix))) * aNormal;
+#endif
+   fragPos = vec3(modelMatrix * vec4(aPos, 1.0));  
 }
\ No newline at end of file
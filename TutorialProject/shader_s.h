@@ -2,22 +2,234 @@
 #define SHADER_H
 
 #include <glad/glad.h>
+#include "gl_extensions.h"
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <sys/types.h>
+#include <sys/stat.h>
 
+//Pre-resolved uniform location, fetch once with Shader::uniform and reuse every frame
+struct UniformHandle
+{
+    int location = -1;
+    bool valid() const { return location != -1; }
+};
 
+//Vertex + fragment program. Linked programs are cached next to the vertex shader as driver binaries keyed on the sources
+//and the driver, so later launches skip compiling. Sources can be watched and rebuilt while running with reloadIfChanged
 class Shader
 {
 public:
     unsigned int shaderProgram;
-    Shader(const char* vertexPath, const char* fragmentPath)
+    //With waitForLink false the compile is only started, call finish() before using the program. Lets the driver
+    //compile several programs at once when it supports GL_KHR_parallel_shader_compile.
+    //Each of defines ("NAME" or "NAME VALUE") becomes a #define in both stages, right after their #version line.
+    //prelude is GLSL shared between programs, such as FRAME_DATA_GLSL, and goes in after the defines
+    Shader(const char* vertexPath, const char* fragmentPath, bool waitForLink = true, const std::vector<std::string>& defines = std::vector<std::string>(),
+        const std::string& prelude = std::string())
+        : vertexPath(vertexPath), fragmentPath(fragmentPath)
+    {
+        for (const std::string& define : defines)
+            defineBlock += "#define " + define + "\n";
+        defineBlock += prelude;
+        if (!defineBlock.empty() && defineBlock.back() != '\n')
+            defineBlock += "\n";
+        vertexModified = fileModifiedTime(this->vertexPath);
+        fragmentModified = fileModifiedTime(this->fragmentPath);
+        std::string vertexCode;
+        std::string fragmentCode;
+        readSources(vertexCode, fragmentCode);
+        binaryKey = programKey(vertexCode, fragmentCode);
+        shaderProgram = loadBinary(binaryKey);
+        if (shaderProgram == 0)
+        {
+            shaderProgram = compile(vertexCode, fragmentCode, vertexShader, fragmentShader);
+            linking = true;
+        }
+        if (!linking)
+            cacheUniforms();
+        else if (waitForLink)
+            finish();
+    }
+    //Wait for a compile started by the constructor, check it and cache the binary. False if it failed
+    bool finish()
+    {
+        if (!linking)
+            return true;
+        linking = false;
+        bool linked = link(shaderProgram, vertexShader, fragmentShader);
+        if (linked)
+            saveBinary(shaderProgram, binaryKey);
+        cacheUniforms();
+        return linked;
+    }
+    //Rebuild if either source file changed on disk. The old program is kept if the new one fails, true only when
+    //shaderProgram was replaced, in which case uniform handles, block bindings and uniform values have to be set up again
+    bool reloadIfChanged()
     {
-        //Retrieve vertex/fragment shader GLSL from path
+        long long newVertexModified = fileModifiedTime(vertexPath);
+        long long newFragmentModified = fileModifiedTime(fragmentPath);
+        if (linking || (newVertexModified == vertexModified && newFragmentModified == fragmentModified))
+            return false;
+        //Remember the new times even if the build fails, so a broken file isn't rebuilt every poll
+        vertexModified = newVertexModified;
+        fragmentModified = newFragmentModified;
         std::string vertexCode;
         std::string fragmentCode;
+        if (!readSources(vertexCode, fragmentCode))
+            return false;
+        std::uint64_t key = programKey(vertexCode, fragmentCode);
+        unsigned int program = loadBinary(key);
+        if (program == 0)
+        {
+            unsigned int newVertexShader, newFragmentShader;
+            program = compile(vertexCode, fragmentCode, newVertexShader, newFragmentShader);
+            if (!link(program, newVertexShader, newFragmentShader))
+            {
+                std::cout << "ERROR::SHADER::RELOAD_FAILED keeping the previous program for " << vertexPath << std::endl;
+                glDeleteProgram(program);
+                return false;
+            }
+            saveBinary(program, key);
+        }
+        glDeleteProgram(shaderProgram);
+        shaderProgram = program;
+        binaryKey = key;
+        cacheUniforms();
+        std::cout << "Reloaded " << vertexPath << " + " << fragmentPath << std::endl;
+        return true;
+    }
+    //Use shader program object
+    void use()
+    {
+        glUseProgram(shaderProgram);
+    }
+    //Point a named uniform block at a buffer binding point, does nothing if the block isn't used by this program
+    void bindUniformBlock(const char* name, unsigned int binding) const
+    {
+        unsigned int index = glGetUniformBlockIndex(shaderProgram, name);
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(shaderProgram, index, binding);
+    }
+    //Look up a uniform in the table built at link time, no GL queries. Invalid handle if the uniform isn't active
+    UniformHandle uniform(const char* name) const
+    {
+        UniformHandle handle;
+        auto it = std::lower_bound(uniforms.begin(), uniforms.end(), name,
+            [](const UniformEntry& entry, const char* key) { return std::strcmp(entry.name.c_str(), key) < 0; });
+        if (it != uniforms.end() && it->name == name)
+            handle.location = it->location;
+        return handle;
+    }
+    //Uniform setting functions through pre-resolved handles, use these in the render loop
+    void setBool(UniformHandle handle, bool value) const
+    {
+        glUniform1i(handle.location, (int)value);
+    }
+    void setInt(UniformHandle handle, int value) const
+    {
+        glUniform1i(handle.location, value);
+    }
+    void setFloat(UniformHandle handle, float value) const
+    {
+        glUniform1f(handle.location, value);
+    }
+    void setVec2(UniformHandle handle, const glm::vec2& value) const
+    {
+        glUniform2fv(handle.location, 1, &value[0]);
+    }
+    void setVec3(UniformHandle handle, const glm::vec3& value) const
+    {
+        glUniform3fv(handle.location, 1, &value[0]);
+    }
+    void setVec3(UniformHandle handle, float x, float y, float z) const
+    {
+        glUniform3f(handle.location, x, y, z);
+    }
+    void setVec4(UniformHandle handle, const glm::vec4& value) const
+    {
+        glUniform4fv(handle.location, 1, &value[0]);
+    }
+    void setMat3(UniformHandle handle, const glm::mat3& mat) const
+    {
+        glUniformMatrix3fv(handle.location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat4(UniformHandle handle, const glm::mat4& mat) const
+    {
+        glUniformMatrix4fv(handle.location, 1, GL_FALSE, &mat[0][0]);
+    }
+    //Basic uniform setting functions by name, fine for one off setup
+    void setBool(const std::string& name, bool value) const
+    {
+        setBool(uniform(name.c_str()), value);
+    }
+    void setInt(const std::string& name, int value) const
+    {
+        setInt(uniform(name.c_str()), value);
+    }
+    void setFloat(const std::string& name, float value) const
+    {
+        setFloat(uniform(name.c_str()), value);
+    }
+    void setVec3(const std::string& name, const glm::vec3& value) const
+    {
+        setVec3(uniform(name.c_str()), value);
+    }
+    void setVec3(const std::string& name, float x, float y, float z) const
+    {
+        setVec3(uniform(name.c_str()), x, y, z);
+    }
+    void setMat3(const std::string& name, const glm::mat3& mat) const
+    {
+        setMat3(uniform(name.c_str()), mat);
+    }
+    void setMat4(const std::string& name, const glm::mat4& mat) const
+    {
+        setMat4(uniform(name.c_str()), mat);
+    }
+private:
+    struct UniformEntry
+    {
+        std::string name;
+        int location;
+    };
+    //Active uniforms sorted by name, filled once after linking
+    std::vector<UniformEntry> uniforms;
+    std::string vertexPath;
+    std::string fragmentPath;
+    //#define lines and the prelude, inserted into both sources
+    std::string defineBlock;
+    long long vertexModified = 0;
+    long long fragmentModified = 0;
+    //Shader objects of a compile started by the constructor, valid while linking
+    bool linking = false;
+    unsigned int vertexShader = 0;
+    unsigned int fragmentShader = 0;
+    std::uint64_t binaryKey = 0;
+
+    //Header in front of the driver's bytes in a .progbin file
+    struct ProgramBinaryHeader
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint64_t key;
+        std::uint32_t format;
+        std::uint32_t length;
+    };
+    static const std::uint32_t PROGRAM_BINARY_MAGIC = 0x42525050; //"PPRB"
+    static const std::uint32_t PROGRAM_BINARY_VERSION = 1;
+
+    //Retrieve vertex/fragment shader GLSL from path
+    bool readSources(std::string& vertexCode, std::string& fragmentCode) const
+    {
         std::ifstream vShaderFile;
         std::ifstream fShaderFile;
         //Ensure ifstream objects can throw exceptions:
@@ -39,64 +251,201 @@ public:
         catch (std::ifstream::failure& e)
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+            return false;
         }
+        insertDefines(vertexCode);
+        insertDefines(fragmentCode);
+        return true;
+    }
+
+    //#version has to stay the first statement, so the defines and prelude go on the line after it. #line keeps error
+    //line numbers pointing at the file on disk
+    void insertDefines(std::string& code) const
+    {
+        if (defineBlock.empty())
+            return;
+        size_t insertAt = 0;
+        size_t version = code.find("#version");
+        if (version != std::string::npos)
+        {
+            size_t lineEnd = code.find('\n', version);
+            insertAt = lineEnd == std::string::npos ? code.size() : lineEnd + 1;
+        }
+        size_t nextLine = (size_t)std::count(code.begin(), code.begin() + insertAt, '\n') + 1;
+        std::string block = defineBlock + "#line " + std::to_string(nextLine) + "\n";
+        if (insertAt > 0 && code[insertAt - 1] != '\n')
+            block = "\n" + block;
+        code.insert(insertAt, block);
+    }
+
+    //Start compiling and linking, doesn't check anything so the driver can work on it in the background
+    unsigned int compile(const std::string& vertexCode, const std::string& fragmentCode, unsigned int& newVertexShader, unsigned int& newFragmentShader) const
+    {
         const char* vShaderCode = vertexCode.c_str();
         const char* fShaderCode = fragmentCode.c_str();
-        //Build shaders
-        unsigned int vertexShader, fragmentShader;
         //Vertex shader
-        vertexShader = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertexShader, 1, &vShaderCode, NULL);
-        glCompileShader(vertexShader);
-        checkCompileErrors(vertexShader, "VERTEX");
+        newVertexShader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(newVertexShader, 1, &vShaderCode, NULL);
+        glCompileShader(newVertexShader);
         //Fragment Shader
-        fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragmentShader, 1, &fShaderCode, NULL);
-        glCompileShader(fragmentShader);
-        checkCompileErrors(fragmentShader, "FRAGMENT");
+        newFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(newFragmentShader, 1, &fShaderCode, NULL);
+        glCompileShader(newFragmentShader);
         //Shader Program
-        shaderProgram = glCreateProgram();
-        glAttachShader(shaderProgram, vertexShader);
-        glAttachShader(shaderProgram, fragmentShader);
-        glLinkProgram(shaderProgram);
-        checkCompileErrors(shaderProgram, "PROGRAM");
-        //Can delete shaders as they're linked now
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
+        unsigned int program = glCreateProgram();
+        glAttachShader(program, newVertexShader);
+        glAttachShader(program, newFragmentShader);
+        //Has to be set before linking for glGetProgramBinary to return anything
+        if (programParameteriFunction())
+            programParameteriFunction()(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(program);
+        return program;
     }
-    //Use shader program object
-    void use()
+
+    //Check a compile() result. Shaders are deleted either way
+    bool link(unsigned int program, unsigned int newVertexShader, unsigned int newFragmentShader)
     {
-        glUseProgram(shaderProgram);
+        bool vertexCompiled = checkCompileErrors(newVertexShader, "VERTEX");
+        bool fragmentCompiled = checkCompileErrors(newFragmentShader, "FRAGMENT");
+        bool linked = checkCompileErrors(program, "PROGRAM");
+        //Can delete shaders as they're linked now
+        glDetachShader(program, newVertexShader);
+        glDetachShader(program, newFragmentShader);
+        glDeleteShader(newVertexShader);
+        glDeleteShader(newFragmentShader);
+        return vertexCompiled && fragmentCompiled && linked;
     }
-    //Basic uniform setting functions
-    void setBool(const std::string& name, bool value) const
+
+    //FNV-1a over both sources and the driver strings, a driver update or different GPU never loads a stale binary
+    static std::uint64_t programKey(const std::string& vertexCode, const std::string& fragmentCode)
     {
-        glUniform1i(glGetUniformLocation(shaderProgram, name.c_str()), (int)value);
+        std::uint64_t hash = 14695981039346656037ull;
+        const char* driver[] = { (const char*)glGetString(GL_VENDOR), (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION) };
+        std::string parts[5] = { vertexCode, fragmentCode, driver[0] ? driver[0] : "", driver[1] ? driver[1] : "", driver[2] ? driver[2] : "" };
+        for (const std::string& part : parts)
+        {
+            //Terminator included so moving text between parts changes the hash
+            for (size_t i = 0; i <= part.size(); i++)
+            {
+                hash ^= (unsigned char)part.c_str()[i];
+                hash *= 1099511628211ull;
+            }
+        }
+        return hash;
     }
-    void setInt(const std::string& name, int value) const
+
+    //Next to the vertex shader, named after both paths and the defines so programs sharing a vertex shader don't overwrite each other
+    std::string binaryPath() const
     {
-        glUniform1i(glGetUniformLocation(shaderProgram, name.c_str()), value);
+        std::uint64_t hash = 14695981039346656037ull;
+        std::string name = vertexPath + "|" + fragmentPath + "|" + defineBlock;
+        for (char c : name)
+        {
+            hash ^= (unsigned char)c;
+            hash *= 1099511628211ull;
+        }
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), ".%016llx.progbin", (unsigned long long)hash);
+        return vertexPath + suffix;
     }
-    void setFloat(const std::string& name, float value) const
+
+    //Program from the cached binary, 0 if there's no usable one and the sources have to be compiled
+    unsigned int loadBinary(std::uint64_t key) const
     {
-        glUniform1f(glGetUniformLocation(shaderProgram, name.c_str()), value);
+        if (!programBinaryFunction())
+            return 0;
+        std::ifstream file(binaryPath(), std::ios::binary);
+        if (!file)
+            return 0;
+        ProgramBinaryHeader header;
+        if (!file.read((char*)&header, sizeof(header)) || header.magic != PROGRAM_BINARY_MAGIC
+            || header.version != PROGRAM_BINARY_VERSION || header.key != key || header.length == 0)
+            return 0;
+        std::vector<char> binary(header.length);
+        if (!file.read(binary.data(), binary.size()))
+            return 0;
+        unsigned int program = glCreateProgram();
+        programBinaryFunction()(program, (GLenum)header.format, binary.data(), (GLsizei)binary.size());
+        //Drivers may still refuse a binary they wrote themselves, that's a normal miss not an error
+        int linked = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked)
+        {
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
     }
-    void setVec3(const std::string& name, const glm::vec3& value) const
+
+    void saveBinary(unsigned int program, std::uint64_t key) const
     {
-        glUniform3fv(glGetUniformLocation(shaderProgram, name.c_str()), 1, &value[0]);
+        if (!getProgramBinaryFunction())
+            return;
+        int length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        getProgramBinaryFunction()(program, (GLsizei)length, &length, &format, binary.data());
+        ProgramBinaryHeader header = { PROGRAM_BINARY_MAGIC, PROGRAM_BINARY_VERSION, key, (std::uint32_t)format, (std::uint32_t)length };
+        std::ofstream file(binaryPath(), std::ios::binary | std::ios::trunc);
+        if (!file.write((const char*)&header, sizeof(header)) || !file.write(binary.data(), length))
+            std::cout << "ERROR::SHADER::BINARY_NOT_WRITTEN " << binaryPath() << std::endl;
     }
-    void setVec3(const std::string& name, float x, float y, float z) const
+
+    //Modification time for reload polling, 0 if the file can't be read
+    static long long fileModifiedTime(const std::string& path)
     {
-        glUniform3f(glGetUniformLocation(shaderProgram, name.c_str()), x, y, z);
+#ifdef _WIN32
+        struct _stat64 fileStat;
+        if (_stat64(path.c_str(), &fileStat) != 0)
+            return 0;
+#else
+        struct stat fileStat;
+        if (stat(path.c_str(), &fileStat) != 0)
+            return 0;
+#endif
+        return (long long)fileStat.st_mtime;
     }
-    void setMat4(const std::string& name, const glm::mat4& mat) const
+
+    //Query every active uniform once so lookups never touch the driver
+    void cacheUniforms()
     {
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        uniforms.clear();
+        int count = 0;
+        int maxLength = 0;
+        glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<char> nameBuffer(maxLength > 0 ? maxLength : 1);
+        for (int i = 0; i < count; i++)
+        {
+            int length = 0;
+            int size = 0;
+            GLenum type;
+            glGetActiveUniform(shaderProgram, (GLuint)i, (GLsizei)nameBuffer.size(), &length, &size, &type, nameBuffer.data());
+            UniformEntry entry;
+            entry.name.assign(nameBuffer.data(), length);
+            entry.location = glGetUniformLocation(shaderProgram, entry.name.c_str());
+            //Uniform block members have no location, they're set through buffers instead
+            if (entry.location == -1)
+                continue;
+            //Arrays are reported as "name[0]", also allow looking them up by the bare name
+            if (entry.name.size() > 3 && entry.name.compare(entry.name.size() - 3, 3, "[0]") == 0)
+            {
+                UniformEntry bare;
+                bare.name = entry.name.substr(0, entry.name.size() - 3);
+                bare.location = entry.location;
+                uniforms.push_back(bare);
+            }
+            uniforms.push_back(entry);
+        }
+        std::sort(uniforms.begin(), uniforms.end(),
+            [](const UniformEntry& a, const UniformEntry& b) { return a.name < b.name; });
     }
-private:
-    //Error checking shader compilation
-    void checkCompileErrors(unsigned int shader, std::string type)
+
+    //Error checking shader compilation, false if it failed
+    bool checkCompileErrors(unsigned int shader, std::string type)
     {
         int success;
         char infoLog[1024];
@@ -118,6 +467,7 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success != 0;
     }
 };
 
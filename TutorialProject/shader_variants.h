@@ -0,0 +1,111 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include "shader_s.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <functional>
+
+//Compile time permutations of one vertex + fragment pair. Bit i of a feature mask adds featureDefines[i] as a #define,
+//each mask is built once and kept, so choosing a variant per draw is only a lookup
+class ShaderVariants
+{
+public:
+    //setup runs on every variant once it's linked and again after a reload, for block bindings and constant uniforms.
+    //prelude goes to every variant's Shader
+    ShaderVariants(const char* vertexPath, const char* fragmentPath, std::vector<std::string> featureDefines, std::function<void(Shader&)> setup,
+        std::string prelude = std::string())
+        : vertexPath(vertexPath), fragmentPath(fragmentPath), featureDefines(std::move(featureDefines)), setup(std::move(setup)), prelude(std::move(prelude))
+    {
+    }
+
+    //Start building a variant without waiting for it, for ones likely to be needed soon
+    void prepare(unsigned int features)
+    {
+        if (variants.find(features) == variants.end())
+            variants[features] = Variant{ build(features), false };
+    }
+
+    //Wait for every prepared variant
+    void finish()
+    {
+        for (std::pair<const unsigned int, Variant>& variant : variants)
+            ready(variant.second);
+    }
+
+    //Variant with exactly these features, built on the spot the first time it's asked for
+    Shader& get(unsigned int features)
+    {
+        prepare(features);
+        Variant& variant = variants[features];
+        ready(variant);
+        return *variant.shader;
+    }
+
+    //Reload every built variant whose sources changed, true if any program was replaced
+    bool reloadIfChanged()
+    {
+        bool reloaded = false;
+        for (std::pair<const unsigned int, Variant>& variant : variants)
+        {
+            if (variant.second.ready && variant.second.shader->reloadIfChanged())
+            {
+                setup(*variant.second.shader);
+                reloaded = true;
+            }
+        }
+        return reloaded;
+    }
+
+    void destroy()
+    {
+        for (std::pair<const unsigned int, Variant>& variant : variants)
+            glDeleteProgram(variant.second.shader->shaderProgram);
+        variants.clear();
+    }
+
+    size_t size() const
+    {
+        return variants.size();
+    }
+
+private:
+    struct Variant
+    {
+        std::unique_ptr<Shader> shader;
+        //Linked and set up
+        bool ready;
+    };
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::vector<std::string> featureDefines;
+    std::function<void(Shader&)> setup;
+    std::string prelude;
+    std::map<unsigned int, Variant> variants;
+
+    //Only starts the compile, ready() waits for it
+    std::unique_ptr<Shader> build(unsigned int features) const
+    {
+        std::vector<std::string> defines;
+        for (size_t i = 0; i < featureDefines.size(); i++)
+        {
+            if (features & (1u << i))
+                defines.push_back(featureDefines[i]);
+        }
+        return std::unique_ptr<Shader>(new Shader(vertexPath.c_str(), fragmentPath.c_str(), false, defines, prelude));
+    }
+
+    void ready(Variant& variant)
+    {
+        if (variant.ready)
+            return;
+        variant.shader->finish();
+        setup(*variant.shader);
+        variant.ready = true;
+    }
+};
+
+#endif
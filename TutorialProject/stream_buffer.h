@@ -0,0 +1,172 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+#include "gl_extensions.h"
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+
+//One allocation out of a StreamBuffer, write to data then hand it back with commit
+struct StreamAllocation
+{
+    void* data = nullptr;
+    //Byte offset into StreamBuffer::buffer, for attribute pointers and glBindBufferRange
+    size_t offset = 0;
+    size_t size = 0;
+};
+
+//Wait counters, a frame that had to wait for the GPU to finish with its region counts as one stall
+struct StreamBufferStats
+{
+    unsigned long long frames = 0;
+    unsigned long long stalls = 0;
+    double stallMilliseconds = 0.0;
+    //Allocations refused because a frame ran out of room in its region
+    unsigned long long overflows = 0;
+};
+
+//Ring of REGIONS per-frame regions in one buffer for data rewritten every frame. Each region gets a fence when its frame
+//is done, and the region is only handed out again once that fence has passed, so writes never race the GPU and the driver
+//never has to sync on its own. Persistently mapped when GL_ARB_buffer_storage is there, otherwise each allocation is
+//mapped unsynchronized
+class StreamBuffer
+{
+public:
+    static const unsigned int REGIONS = 3;
+
+    unsigned int buffer = 0;
+    bool persistent = false;
+    StreamBufferStats stats;
+
+    //Room for regionSize bytes of allocations per frame
+    bool create(size_t newRegionSize)
+    {
+        destroy();
+        regionSize = newRegionSize;
+        glGenBuffers(1, &buffer);
+        //Copy write target so creating and mapping doesn't disturb the array, element or uniform bindings
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        BufferStorageFunction bufferStorage = bufferStorageFunction();
+        persistent = bufferStorage != nullptr;
+        if (persistent)
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            bufferStorage(GL_COPY_WRITE_BUFFER, (GLsizeiptr)(regionSize * REGIONS), NULL, flags);
+            mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, (GLsizeiptr)(regionSize * REGIONS), flags);
+            if (mapped == nullptr)
+            {
+                std::cout << "ERROR::STREAM_BUFFER::PERSISTENT_MAP_FAILED" << std::endl;
+                glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+                destroy();
+                return false;
+            }
+        }
+        else
+        {
+            glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)(regionSize * REGIONS), NULL, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return true;
+    }
+
+    void destroy()
+    {
+        for (unsigned int i = 0; i < REGIONS; i++)
+        {
+            if (fences[i])
+                glDeleteSync(fences[i]);
+            fences[i] = 0;
+        }
+        if (buffer)
+        {
+            if (mapped)
+            {
+                glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+                glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            }
+            glDeleteBuffers(1, &buffer);
+        }
+        buffer = 0;
+        mapped = nullptr;
+    }
+
+    //Move to the next region, waiting for the GPU only if it's still reading that region from REGIONS frames ago
+    void beginFrame()
+    {
+        region = (region + 1) % REGIONS;
+        used = 0;
+        stats.frames++;
+        GLsync fence = fences[region];
+        if (!fence)
+            return;
+        fences[region] = 0;
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            do
+                status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            while (status == GL_TIMEOUT_EXPIRED);
+            stats.stalls++;
+            stats.stallMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        glDeleteSync(fence);
+    }
+
+    //Fence the region once every draw reading it has been issued
+    void endFrame()
+    {
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    //Space for bytes in this frame's region, offset rounded up to alignment. Null data if the region is full
+    StreamAllocation allocate(size_t bytes, size_t alignment = 16)
+    {
+        StreamAllocation allocation;
+        size_t start = (used + alignment - 1) / alignment * alignment;
+        if (start + bytes > regionSize)
+        {
+            stats.overflows++;
+            return allocation;
+        }
+        used = start + bytes;
+        allocation.offset = region * regionSize + start;
+        allocation.size = bytes;
+        if (persistent)
+        {
+            allocation.data = mapped + allocation.offset;
+        }
+        else
+        {
+            //The fence already guarantees the GPU is done with this range, so skip the driver's own sync
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            allocation.data = glMapBufferRange(GL_COPY_WRITE_BUFFER, (GLintptr)allocation.offset, (GLsizeiptr)bytes,
+                GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        return allocation;
+    }
+
+    //Done writing, the data is visible to draws issued after this
+    void commit(const StreamAllocation& allocation)
+    {
+        //Persistent mappings are coherent, nothing to do
+        if (persistent || allocation.data == nullptr)
+            return;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+private:
+    size_t regionSize = 0;
+    unsigned int region = REGIONS - 1;
+    size_t used = 0;
+    unsigned char* mapped = nullptr;
+    GLsync fences[REGIONS] = {};
+};
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef TEXT_OVERLAY_H
+#define TEXT_OVERLAY_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "shader_s.h"
+#include "render_state.h"
+
+#include <string>
+#include <vector>
+#include <cctype>
+
+//Screen space text drawn with a built in 3x5 pixel font, one quad per lit font pixel. Meant for a handful of debug lines, not general text
+class TextOverlay
+{
+public:
+    //Screen pixels per font pixel
+    static const int SCALE = 2;
+    static const int GLYPH_WIDTH = 3;
+    static const int GLYPH_HEIGHT = 5;
+    static const int ADVANCE = (GLYPH_WIDTH + 1) * SCALE;
+    static const int LINE_HEIGHT = (GLYPH_HEIGHT + 2) * SCALE;
+    static const int MARGIN = 8;
+
+    Shader shader;
+    unsigned int VAO;
+    unsigned int VBO;
+
+    TextOverlay() : shader("overlay.vs", "overlay.fs")
+    {
+        screenSizeUniform = shader.uniform("screenSize");
+        colorUniform = shader.uniform("color");
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+        glEnableVertexAttribArray(0);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    //Rebuild the quads, only needed when the text changes. Lowercase letters are drawn as uppercase, unknown characters as blanks
+    void setText(RenderState& state, const std::string& text)
+    {
+        std::vector<glm::vec2> glyphs;
+        int column = 0;
+        int row = 0;
+        int widestColumn = 0;
+        for (char c : text)
+        {
+            if (c == '\n')
+            {
+                row++;
+                column = 0;
+                continue;
+            }
+            const unsigned char* rows = glyphRows((char)std::toupper((unsigned char)c));
+            float x = (float)(MARGIN + column * ADVANCE);
+            float y = (float)(MARGIN + row * LINE_HEIGHT);
+            for (int gy = 0; rows && gy < GLYPH_HEIGHT; gy++)
+            {
+                for (int gx = 0; gx < GLYPH_WIDTH; gx++)
+                {
+                    if (rows[gy] & (4 >> gx))
+                        addQuad(glyphs, x + gx * SCALE, y + gy * SCALE, (float)SCALE, (float)SCALE);
+                }
+            }
+            column++;
+            widestColumn = column > widestColumn ? column : widestColumn;
+        }
+        int lines = text.empty() || text.back() == '\n' ? row : row + 1;
+
+        //Backing panel goes first so the glyphs draw over it
+        std::vector<glm::vec2> vertices;
+        if (lines > 0)
+            addQuad(vertices, MARGIN / 2.0f, MARGIN / 2.0f, (float)(widestColumn * ADVANCE + MARGIN), (float)(lines * LINE_HEIGHT + MARGIN));
+        backgroundVertices = (int)vertices.size();
+        vertices.insert(vertices.end(), glyphs.begin(), glyphs.end());
+        vertexCount = (int)vertices.size();
+
+        state.bindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec2), vertices.data(), GL_DYNAMIC_DRAW);
+    }
+
+    //Draw over whatever is in the bound framebuffer, with depth testing off and blending on
+    void draw(RenderState& state)
+    {
+        if (vertexCount == 0)
+            return;
+        int viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        state.setEnabled(GL_DEPTH_TEST, false);
+        state.setEnabled(GL_BLEND, true);
+        state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        state.useProgram(shader.shaderProgram);
+        shader.setVec2(screenSizeUniform, glm::vec2((float)viewport[2], (float)viewport[3]));
+        state.bindVertexArray(VAO);
+        shader.setVec4(colorUniform, glm::vec4(0.0f, 0.0f, 0.0f, 0.6f));
+        glDrawArrays(GL_TRIANGLES, 0, backgroundVertices);
+        shader.setVec4(colorUniform, glm::vec4(1.0f, 1.0f, 0.6f, 1.0f));
+        glDrawArrays(GL_TRIANGLES, backgroundVertices, vertexCount - backgroundVertices);
+    }
+
+    void destroy()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteProgram(shader.shaderProgram);
+    }
+
+private:
+    UniformHandle screenSizeUniform;
+    UniformHandle colorUniform;
+    int backgroundVertices = 0;
+    int vertexCount = 0;
+
+    struct Glyph
+    {
+        char character;
+        //Top to bottom, bit 2 is the leftmost pixel
+        unsigned char rows[GLYPH_HEIGHT];
+    };
+
+    //Font pixels for a character, null for blanks
+    static const unsigned char* glyphRows(char c)
+    {
+        static const Glyph font[] = {
+            { '0', { 7, 5, 5, 5, 7 } }, { '1', { 2, 6, 2, 2, 7 } }, { '2', { 7, 1, 7, 4, 7 } }, { '3', { 7, 1, 3, 1, 7 } },
+            { '4', { 5, 5, 7, 1, 1 } }, { '5', { 7, 4, 7, 1, 7 } }, { '6', { 7, 4, 7, 5, 7 } }, { '7', { 7, 1, 1, 1, 1 } },
+            { '8', { 7, 5, 7, 5, 7 } }, { '9', { 7, 5, 7, 1, 7 } },
+            { 'A', { 2, 5, 7, 5, 5 } }, { 'B', { 6, 5, 6, 5, 6 } }, { 'C', { 3, 4, 4, 4, 3 } }, { 'D', { 6, 5, 5, 5, 6 } },
+            { 'E', { 7, 4, 6, 4, 7 } }, { 'F', { 7, 4, 6, 4, 4 } }, { 'G', { 3, 4, 5, 5, 3 } }, { 'H', { 5, 5, 7, 5, 5 } },
+            { 'I', { 7, 2, 2, 2, 7 } }, { 'J', { 1, 1, 1, 5, 2 } }, { 'K', { 5, 5, 6, 5, 5 } }, { 'L', { 4, 4, 4, 4, 7 } },
+            { 'M', { 5, 7, 7, 5, 5 } }, { 'N', { 6, 5, 5, 5, 5 } }, { 'O', { 2, 5, 5, 5, 2 } }, { 'P', { 6, 5, 6, 4, 4 } },
+            { 'Q', { 2, 5, 5, 6, 3 } }, { 'R', { 6, 5, 6, 5, 5 } }, { 'S', { 3, 4, 2, 1, 6 } }, { 'T', { 7, 2, 2, 2, 2 } },
+            { 'U', { 5, 5, 5, 5, 7 } }, { 'V', { 5, 5, 5, 5, 2 } }, { 'W', { 5, 5, 7, 7, 5 } }, { 'X', { 5, 5, 2, 5, 5 } },
+            { 'Y', { 5, 5, 2, 2, 2 } }, { 'Z', { 7, 1, 2, 4, 7 } },
+            { '.', { 0, 0, 0, 0, 2 } }, { '-', { 0, 0, 7, 0, 0 } }, { ':', { 0, 2, 0, 2, 0 } }, { '/', { 1, 1, 2, 4, 4 } },
+            { '_', { 0, 0, 0, 0, 7 } }, { '(', { 1, 2, 2, 2, 1 } }, { ')', { 4, 2, 2, 2, 4 } }
+        };
+        for (const Glyph& glyph : font)
+        {
+            if (glyph.character == c)
+                return glyph.rows;
+        }
+        return nullptr;
+    }
+
+    static void addQuad(std::vector<glm::vec2>& vertices, float x, float y, float width, float height)
+    {
+        vertices.push_back(glm::vec2(x, y));
+        vertices.push_back(glm::vec2(x + width, y));
+        vertices.push_back(glm::vec2(x + width, y + height));
+        vertices.push_back(glm::vec2(x + width, y + height));
+        vertices.push_back(glm::vec2(x, y + height));
+        vertices.push_back(glm::vec2(x, y));
+    }
+};
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include <glad/glad.h>
+#include "texture_loader.h"
+#include "texture_cache.h"
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+//Every texture in one GL_TEXTURE_2D_ARRAY, so draws using different textures can share a binding and a batch. All layers have
+//the same size and format. A layer cooked by TextureCooker at that size and format is copied in whole, mips included, straight from
+//its cache file. Anything else shows a placeholder until TextureLoader has decoded, resized and uploaded it, which only an RGBA8
+//array can take; a block compressed one needs every layer cooked
+class TextureArray
+{
+public:
+    unsigned int texture = 0;
+    //GL_RGBA8, or the S3TC format of the caches it's filled from
+    const GLenum internalFormat;
+    const int width;
+    const int height;
+    const unsigned int capacity;
+    const unsigned int levelCount;
+
+    TextureArray(TextureLoader& loader, GLenum internalFormat = GL_RGBA8, int width = TEXTURE_LAYER_SIZE, int height = TEXTURE_LAYER_SIZE, unsigned int capacity = 16)
+        : internalFormat(internalFormat), width(width), height(height), capacity(capacity), levelCount(textureCacheLevelCount(width, height)), loader(loader)
+    {
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+        //Every level up front, cooked layers fill all of them and compressed arrays can't generate any
+        for (unsigned int level = 0; level < levelCount; level++)
+        {
+            int levelWidth = levelSize(width, level);
+            int levelHeight = levelSize(height, level);
+            if (compressed())
+                glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat, levelWidth, levelHeight, capacity, 0,
+                    (GLsizei)(textureCacheLevelSize(cacheFormat(), levelWidth, levelHeight) * capacity), NULL);
+            else
+                glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, levelWidth, levelHeight, capacity, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        createPlaceholder();
+    }
+    TextureArray(const TextureArray&) = delete;
+    TextureArray& operator=(const TextureArray&) = delete;
+
+    //Take the next layer for an image file and fill it from its cache, or show the placeholder and hand it to the loader.
+    //Returns the layer, 0 if the array is full. Call on the GL thread
+    unsigned int add(const std::string& path, bool flipVertically = false)
+    {
+        if (layerCount == capacity)
+        {
+            std::cout << "ERROR::TEXTURE_ARRAY::FULL " << path << std::endl;
+            return 0;
+        }
+        unsigned int layer = layerCount++;
+        //Put back whatever the caller had bound on the active unit
+        int previousTexture;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D_ARRAY, &previousTexture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        bool cached = loadCachedTextureLayer(path, flipVertically, layer, internalFormat, width, height);
+        if (!cached)
+        {
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            for (unsigned int level = 0; level < levelCount; level++)
+            {
+                int levelWidth = levelSize(width, level);
+                int levelHeight = levelSize(height, level);
+                if (compressed())
+                    glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, levelWidth, levelHeight, 1, internalFormat,
+                        (GLsizei)placeholder[level].size(), placeholder[level].data());
+                else
+                    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, levelWidth, levelHeight, 1, GL_RGBA, GL_UNSIGNED_BYTE, placeholder[level].data());
+            }
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, previousTexture);
+        if (cached)
+            return layer;
+        if (compressed())
+            std::cout << "ERROR::TEXTURE_ARRAY::NOT_COOKED " << path << " (cook it with TextureCooker --compress)" << std::endl;
+        else
+            loader.loadLayer(texture, layer, width, height, path, flipVertically);
+        return layer;
+    }
+
+    unsigned int layers() const
+    {
+        return layerCount;
+    }
+
+    void destroy()
+    {
+        glDeleteTextures(1, &texture);
+        texture = 0;
+    }
+
+private:
+    TextureLoader& loader;
+    //One layer's worth of every level, in the array's format
+    std::vector<std::vector<unsigned char>> placeholder;
+    unsigned int layerCount = 0;
+
+    bool compressed() const
+    {
+        return internalFormat != GL_RGBA8;
+    }
+
+    TextureCacheFormat cacheFormat() const
+    {
+        return internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? TEXTURE_CACHE_BC1 : internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ? TEXTURE_CACHE_BC3 : TEXTURE_CACHE_RGBA8;
+    }
+
+    static int levelSize(int size, unsigned int level)
+    {
+        return std::max(1, size >> level);
+    }
+
+    //Grey and white checker, 8 x 8 squares per layer on every level. Compressed levels pick per 4x4 block, each a single color
+    void createPlaceholder()
+    {
+        //565 endpoints both set to the color with all indices 0, then for BC3 an alpha block of solid 255 in front
+        const unsigned char GREY_BLOCK[8] = { 0x10, 0x84, 0x10, 0x84, 0, 0, 0, 0 };
+        const unsigned char WHITE_BLOCK[8] = { 0xFF, 0xFF, 0xFF, 0xFF, 0, 0, 0, 0 };
+        const unsigned char OPAQUE_ALPHA_BLOCK[8] = { 255, 255, 0, 0, 0, 0, 0, 0 };
+        TextureCacheFormat format = cacheFormat();
+        for (unsigned int level = 0; level < levelCount; level++)
+        {
+            int levelWidth = levelSize(width, level);
+            int levelHeight = levelSize(height, level);
+            std::vector<unsigned char> data((size_t)textureCacheLevelSize(format, levelWidth, levelHeight));
+            if (format == TEXTURE_CACHE_RGBA8)
+            {
+                for (int y = 0; y < levelHeight; y++)
+                {
+                    for (int x = 0; x < levelWidth; x++)
+                    {
+                        unsigned char value = ((x * 8 / levelWidth) + (y * 8 / levelHeight)) % 2 == 0 ? 128 : 255;
+                        unsigned char* pixel = &data[((size_t)y * levelWidth + x) * 4];
+                        pixel[0] = pixel[1] = pixel[2] = value;
+                        pixel[3] = 255;
+                    }
+                }
+            }
+            else
+            {
+                int blocksX = (levelWidth + 3) / 4;
+                int blocksY = (levelHeight + 3) / 4;
+                size_t blockSize = format == TEXTURE_CACHE_BC1 ? 8 : 16;
+                for (int by = 0; by < blocksY; by++)
+                {
+                    for (int bx = 0; bx < blocksX; bx++)
+                    {
+                        unsigned char* out = &data[((size_t)by * blocksX + bx) * blockSize];
+                        if (format == TEXTURE_CACHE_BC3)
+                        {
+                            std::memcpy(out, OPAQUE_ALPHA_BLOCK, 8);
+                            out += 8;
+                        }
+                        bool grey = ((bx * 4 * 8 / levelWidth) + (by * 4 * 8 / levelHeight)) % 2 == 0;
+                        std::memcpy(out, grey ? GREY_BLOCK : WHITE_BLOCK, 8);
+                    }
+                }
+            }
+            placeholder.push_back(std::move(data));
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <glad/glad.h>
+#include "texture_cache_format.h"
+#include "mapped_file.h"
+
+#include <string>
+#include <algorithm>
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+//Check the cooked cache of sourcePath against its source and point header and levels into the mapped file. False if there's no cache,
+//it's stale, was cooked with a different flip, or is cut short
+inline bool openTextureCache(MappedFile& file, const std::string& sourcePath, bool flipVertically, const TextureCacheHeader*& header, const TextureCacheLevel*& levels)
+{
+    if (!file.open(textureCachePath(sourcePath)) || file.size() < sizeof(TextureCacheHeader))
+        return false;
+    header = reinterpret_cast<const TextureCacheHeader*>(file.data());
+    if (!textureCacheIsCurrent(*header, sourcePath))
+        return false;
+    if (((header->flags & TEXTURE_CACHE_FLIPPED) != 0) != flipVertically)
+        return false;
+    if (header->levelCount == 0 || file.size() < sizeof(TextureCacheHeader) + header->levelCount * sizeof(TextureCacheLevel))
+        return false;
+    levels = reinterpret_cast<const TextureCacheLevel*>(file.data() + sizeof(TextureCacheHeader));
+    for (unsigned int i = 0; i < header->levelCount; i++)
+    {
+        if (levels[i].offset + levels[i].size > file.size())
+            return false;
+    }
+    return true;
+}
+
+//GL internal format a cooked format uploads as
+inline GLenum textureCacheGLFormat(std::uint32_t format)
+{
+    if (format == TEXTURE_CACHE_BC1)
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    if (format == TEXTURE_CACHE_BC3)
+        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    return GL_RGBA8;
+}
+
+//Upload every level of a cooked texture into one layer of the bound GL_TEXTURE_2D_ARRAY straight from the memory mapped cache file,
+//no decode or mip generation. The cache has to be in the array's internalFormat with the full chain of its width x height layers,
+//which is what TextureCooker writes by default. False otherwise, the source has to be decoded instead
+inline bool loadCachedTextureLayer(const std::string& sourcePath, bool flipVertically, unsigned int layer, GLenum internalFormat, int width, int height)
+{
+    MappedFile file;
+    const TextureCacheHeader* header;
+    const TextureCacheLevel* levels;
+    if (!openTextureCache(file, sourcePath, flipVertically, header, levels))
+        return false;
+    if (header->format > TEXTURE_CACHE_BC3 || textureCacheGLFormat(header->format) != internalFormat
+        || header->width != (std::uint32_t)width || header->height != (std::uint32_t)height
+        || header->levelCount != textureCacheLevelCount(width, height))
+        return false;
+    for (unsigned int i = 0; i < header->levelCount; i++)
+    {
+        if (levels[i].width != std::max(1u, (std::uint32_t)width >> i) || levels[i].height != std::max(1u, (std::uint32_t)height >> i)
+            || levels[i].size != textureCacheLevelSize(header->format, levels[i].width, levels[i].height))
+            return false;
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (unsigned int i = 0; i < header->levelCount; i++)
+    {
+        const TextureCacheLevel& level = levels[i];
+        const unsigned char* pixels = file.data() + level.offset;
+        if (header->format == TEXTURE_CACHE_RGBA8)
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, i, 0, 0, layer, level.width, level.height, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        else
+            glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, i, 0, 0, layer, level.width, level.height, 1, internalFormat, (GLsizei)level.size, pixels);
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,179 @@
+#ifndef TEXTURE_CACHE_FORMAT_H
+#define TEXTURE_CACHE_FORMAT_H
+
+//Layout of the cooked texture files written by TextureCooker and read back by texture_cache.h.
+//No GL in here so the cooker can include it without a context.
+
+#include <string>
+#include <cstdint>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+//Cooked file sits next to its source, e.g. container.jpg -> container.jpg.texcache
+const char* const TEXTURE_CACHE_EXTENSION = ".texcache";
+const char TEXTURE_CACHE_MAGIC[4] = { 'T', 'X', 'C', '1' };
+const std::uint32_t TEXTURE_CACHE_VERSION = 1;
+//Level data offsets are aligned so the mapped pointers suit any upload path
+const std::uint64_t TEXTURE_CACHE_ALIGNMENT = 16;
+
+enum TextureCacheFormat : std::uint32_t
+{
+    TEXTURE_CACHE_RGBA8 = 0,
+    //BC1 / DXT1, 8 bytes per 4x4 block, opaque images only
+    TEXTURE_CACHE_BC1 = 1,
+    //BC3 / DXT5, 16 bytes per 4x4 block, BC1 color plus interpolated alpha
+    TEXTURE_CACHE_BC3 = 2
+};
+
+//Flag bits
+const std::uint32_t TEXTURE_CACHE_FLIPPED = 1;
+
+//Layer size of TutorialProject's texture array. Only caches cooked at this size load straight into a layer, so it's the cooker's default
+const int TEXTURE_LAYER_SIZE = 512;
+
+//Identifies the source image the cache was cooked from
+struct TextureSourceInfo
+{
+    std::uint64_t size = 0;
+    std::int64_t modifiedTime = 0;
+    std::uint64_t hash = 0;
+};
+
+struct TextureCacheHeader
+{
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t format;
+    std::uint32_t flags;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t levelCount;
+    std::uint32_t reserved;
+    TextureSourceInfo source;
+};
+
+//Follows the header, one per mip level starting at the full size level
+struct TextureCacheLevel
+{
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+
+inline std::string textureCachePath(const std::string& sourcePath)
+{
+    return sourcePath + TEXTURE_CACHE_EXTENSION;
+}
+
+//Bytes for one level in the given format, block formats round up to whole 4x4 blocks
+inline std::uint64_t textureCacheLevelSize(std::uint32_t format, std::uint32_t width, std::uint32_t height)
+{
+    if (format == TEXTURE_CACHE_RGBA8)
+        return (std::uint64_t)width * height * 4;
+    std::uint64_t blocks = (std::uint64_t)((width + 3) / 4) * ((height + 3) / 4);
+    return blocks * (format == TEXTURE_CACHE_BC1 ? 8 : 16);
+}
+
+//Levels in a full mip chain, halving with odd sizes rounded down until 1x1 like glGenerateMipmap
+inline std::uint32_t textureCacheLevelCount(std::uint32_t width, std::uint32_t height)
+{
+    std::uint32_t count = 1;
+    for (; width > 1 || height > 1; count++)
+    {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return count;
+}
+
+//Bilinear resample of an RGBA image, pixel centers lined up so a same size copy is exact. Shared by the cooker and the runtime
+//decode path, so a layer looks the same whether it was cooked or not
+inline void resizeTextureRGBA(const unsigned char* source, int sourceWidth, int sourceHeight, unsigned char* target, int targetWidth, int targetHeight)
+{
+    float scaleX = (float)sourceWidth / targetWidth;
+    float scaleY = (float)sourceHeight / targetHeight;
+    for (int y = 0; y < targetHeight; y++)
+    {
+        float sy = std::max((y + 0.5f) * scaleY - 0.5f, 0.0f);
+        int y0 = std::min((int)sy, sourceHeight - 1);
+        int y1 = std::min(y0 + 1, sourceHeight - 1);
+        float fy = sy - y0;
+        for (int x = 0; x < targetWidth; x++)
+        {
+            float sx = std::max((x + 0.5f) * scaleX - 0.5f, 0.0f);
+            int x0 = std::min((int)sx, sourceWidth - 1);
+            int x1 = std::min(x0 + 1, sourceWidth - 1);
+            float fx = sx - x0;
+            const unsigned char* p00 = source + ((size_t)y0 * sourceWidth + x0) * 4;
+            const unsigned char* p10 = source + ((size_t)y0 * sourceWidth + x1) * 4;
+            const unsigned char* p01 = source + ((size_t)y1 * sourceWidth + x0) * 4;
+            const unsigned char* p11 = source + ((size_t)y1 * sourceWidth + x1) * 4;
+            unsigned char* out = target + ((size_t)y * targetWidth + x) * 4;
+            for (int c = 0; c < 4; c++)
+            {
+                float top = p00[c] + (p10[c] - p00[c]) * fx;
+                float bottom = p01[c] + (p11[c] - p01[c]) * fx;
+                out[c] = (unsigned char)(top + (bottom - top) * fy + 0.5f);
+            }
+        }
+    }
+}
+
+//Size and modification time, cheap check done every launch
+inline bool readTextureSourceStat(const std::string& path, TextureSourceInfo& info)
+{
+#ifdef _WIN32
+    struct _stat64 fileStat;
+    if (_stat64(path.c_str(), &fileStat) != 0)
+        return false;
+#else
+    struct stat fileStat;
+    if (stat(path.c_str(), &fileStat) != 0)
+        return false;
+#endif
+    info.size = (std::uint64_t)fileStat.st_size;
+    info.modifiedTime = (std::int64_t)fileStat.st_mtime;
+    return true;
+}
+
+//FNV-1a over the whole file, only needed when the timestamp no longer matches
+inline bool hashTextureSource(const std::string& path, std::uint64_t& hash)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    hash = 14695981039346656037ull;
+    char buffer[64 * 1024];
+    while (file)
+    {
+        file.read(buffer, sizeof(buffer));
+        std::streamsize read = file.gcount();
+        for (std::streamsize i = 0; i < read; i++)
+        {
+            hash ^= (unsigned char)buffer[i];
+            hash *= 1099511628211ull;
+        }
+    }
+    return !file.bad();
+}
+
+//A cache is current when the source's size and timestamp match, or failing that its contents hash the same
+inline bool textureCacheIsCurrent(const TextureCacheHeader& header, const std::string& sourcePath)
+{
+    if (std::memcmp(header.magic, TEXTURE_CACHE_MAGIC, 4) != 0 || header.version != TEXTURE_CACHE_VERSION)
+        return false;
+    TextureSourceInfo info;
+    if (!readTextureSourceStat(sourcePath, info))
+        return false;
+    if (info.size != header.source.size)
+        return false;
+    if (info.modifiedTime == header.source.modifiedTime)
+        return true;
+    return hashTextureSource(sourcePath, info.hash) && info.hash == header.source.hash;
+}
+
+#endif
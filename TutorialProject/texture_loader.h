@@ -0,0 +1,196 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+#include <image_loader_library/stb_image.h>
+#include "thread_pool.h"
+#include "texture_cache_format.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+
+//Decodes images on the thread pool, resizes them to the layer they're for and uploads them into a GL_TEXTURE_2D_ARRAY through a
+//pixel buffer object on the GL thread, a budgeted amount per frame. The layer keeps whatever the caller put in it until then.
+//Cooked textures never come through here, TextureArray uploads them from their cache file directly
+class TextureLoader
+{
+public:
+    //Pixel unpack buffer used for uploads
+    unsigned int pbo = 0;
+
+    TextureLoader(ThreadPool& pool, size_t uploadBudgetBytes = 8 * 1024 * 1024)
+        : pool(pool), uploadBudgetBytes(uploadBudgetBytes), decoded(std::make_shared<DecodedQueue>())
+    {
+        glGenBuffers(1, &pbo);
+    }
+    ~TextureLoader()
+    {
+        //Free anything decoded but never uploaded
+        std::lock_guard<std::mutex> lock(decoded->mutex);
+        for (DecodedImage& image : decoded->images)
+            stbi_image_free(image.pixels);
+    }
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    //Queue an image file for layer of arrayTexture, width x height RGBA8 layers. Its mips are rebuilt once it's uploaded
+    void loadLayer(unsigned int arrayTexture, unsigned int layer, int width, int height, const std::string& path, bool flipVertically = false)
+    {
+        pendingCount++;
+        //Only the shared queue is captured, so jobs finishing after the loader is gone are harmless
+        std::shared_ptr<DecodedQueue> queue = decoded;
+        pool.submit([queue, path, flipVertically, arrayTexture, layer, width, height]()
+        {
+            DecodedImage image;
+            image.texture = arrayTexture;
+            image.layer = layer;
+            image.path = path;
+            int channels;
+            //Always expand to RGBA so every upload has the same format and row alignment.
+            //The flip is done here per image, stbi_set_flip_vertically_on_load is global state shared across threads
+            image.pixels = stbi_load(path.c_str(), &image.width, &image.height, &channels, 4);
+            if (image.pixels && (image.width != width || image.height != height))
+            {
+                image.resized.resize((size_t)width * height * 4);
+                resizeTextureRGBA(image.pixels, image.width, image.height, image.resized.data(), width, height);
+                stbi_image_free(image.pixels);
+                image.pixels = nullptr;
+                image.width = width;
+                image.height = height;
+            }
+            if (image.data() && flipVertically)
+                flipRows(image.data(), image.width, image.height);
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            queue->images.push_back(std::move(image));
+        });
+    }
+
+    //Upload decoded images until this frame's byte budget is spent (at least one per call), then rebuild the mips of any array
+    //that got a layer. Call once per frame on the GL thread
+    void update()
+    {
+        if (pendingCount == 0)
+            return;
+        //Put back whatever the caller had bound on the active unit
+        int previousArray;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D_ARRAY, &previousArray);
+        //Arrays whose mips need rebuilding, once each however many of their layers came in
+        std::vector<unsigned int> mipmapArrays;
+        size_t uploadedBytes = 0;
+        while (pendingCount > 0 && uploadedBytes < uploadBudgetBytes)
+        {
+            DecodedImage image;
+            {
+                std::lock_guard<std::mutex> lock(decoded->mutex);
+                if (decoded->images.empty())
+                    break;
+                image = std::move(decoded->images.front());
+                decoded->images.pop_front();
+            }
+            pendingCount--;
+            if (!image.data())
+            {
+                std::cout << "Failed to load texture " << image.path << std::endl;
+                continue;
+            }
+            uploadedBytes += upload(image);
+            stbi_image_free(image.pixels);
+            if (std::find(mipmapArrays.begin(), mipmapArrays.end(), image.texture) == mipmapArrays.end())
+                mipmapArrays.push_back(image.texture);
+        }
+        for (unsigned int arrayTexture : mipmapArrays)
+        {
+            glBindTexture(GL_TEXTURE_2D_ARRAY, arrayTexture);
+            glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, previousArray);
+    }
+
+    //Textures queued but not yet resident
+    unsigned int pending() const
+    {
+        return pendingCount;
+    }
+
+    void destroy()
+    {
+        glDeleteBuffers(1, &pbo);
+        pbo = 0;
+    }
+
+private:
+    struct DecodedImage
+    {
+        unsigned int texture = 0;
+        unsigned int layer = 0;
+        std::string path;
+        //From stbi_load, or null with the image in resized when it had to be resized to its layer
+        unsigned char* pixels = nullptr;
+        std::vector<unsigned char> resized;
+        int width = 0;
+        int height = 0;
+
+        unsigned char* data()
+        {
+            return pixels ? pixels : (resized.empty() ? nullptr : resized.data());
+        }
+    };
+    struct DecodedQueue
+    {
+        std::mutex mutex;
+        std::deque<DecodedImage> images;
+    };
+
+    ThreadPool& pool;
+    size_t uploadBudgetBytes;
+    std::shared_ptr<DecodedQueue> decoded;
+    unsigned int pendingCount = 0;
+
+    size_t upload(DecodedImage& image)
+    {
+        size_t size = (size_t)image.width * image.height * 4;
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        //Orphan the PBO so the driver hands back fresh storage instead of waiting on the previous upload
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+        void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        //With a PBO bound the data pointer is an offset into it
+        const void* data = (void*)0;
+        if (mapped)
+        {
+            std::memcpy(mapped, image.data(), size);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        else
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            data = image.data();
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, image.texture);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, image.layer, image.width, image.height, 1, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return size;
+    }
+
+    static void flipRows(unsigned char* pixels, int width, int height)
+    {
+        size_t rowSize = (size_t)width * 4;
+        std::vector<unsigned char> row(rowSize);
+        for (int y = 0; y < height / 2; y++)
+        {
+            unsigned char* top = pixels + y * rowSize;
+            unsigned char* bottom = pixels + (height - 1 - y) * rowSize;
+            std::memcpy(row.data(), top, rowSize);
+            std::memcpy(top, bottom, rowSize);
+            std::memcpy(bottom, row.data(), rowSize);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <atomic>
+#include <memory>
+#include <deque>
+#include <vector>
+#include <algorithm>
+
+//Fixed set of worker threads, each with its own job queue. Workers run their own newest job first and steal
+//the oldest job from another worker when theirs runs dry, so one long job doesn't hold up everything queued behind it
+class ThreadPool
+{
+public:
+    ThreadPool(unsigned int threadCount = 0)
+    {
+        if (threadCount == 0)
+        {
+            //Leave one core for the GL thread
+            unsigned int cores = std::thread::hardware_concurrency();
+            threadCount = cores > 1 ? cores - 1 : 1;
+        }
+        for (unsigned int i = 0; i < threadCount; i++)
+            queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+        for (unsigned int i = 0; i < threadCount; i++)
+            workers.emplace_back([this, i]() { workerLoop(i); });
+    }
+    //Jobs still queued are dropped, jobs already running are finished
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //Jobs submitted from a worker go on that worker's queue, anything else is spread round robin
+    void submit(std::function<void()> job)
+    {
+        unsigned int target;
+        if (currentPool() == this)
+            target = currentWorker();
+        else
+            target = nextQueue.fetch_add(1) % (unsigned int)queues.size();
+        {
+            std::lock_guard<std::mutex> lock(queues[target]->mutex);
+            //Counted before it's visible, a worker that takes it straight away must not decrement first and wrap the count
+            queued.fetch_add(1);
+            queues[target]->jobs.push_back(std::move(job));
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+        wake.notify_one();
+    }
+
+    //Submit a job and get a future that's ready once it has run
+    std::future<void> submitTask(std::function<void()> job)
+    {
+        std::shared_ptr<std::packaged_task<void()>> task = std::make_shared<std::packaged_task<void()>>(std::move(job));
+        std::future<void> done = task->get_future();
+        submit([task]() { (*task)(); });
+        return done;
+    }
+
+    //Run body(begin, end) over [0, count) in chunks of grain and return once every chunk is done.
+    //The calling thread works through chunks too, so this is safe to call from inside a job and never waits on unrelated work
+    void parallelFor(unsigned int count, unsigned int grain, std::function<void(unsigned int, unsigned int)> body)
+    {
+        if (count == 0)
+            return;
+        if (grain == 0)
+            grain = 1;
+        std::shared_ptr<ParallelFor> state = std::make_shared<ParallelFor>();
+        state->count = count;
+        state->grain = grain;
+        state->chunks = (count + grain - 1) / grain;
+        state->body = std::move(body);
+        //Helpers that start after the caller has taken every chunk just return
+        unsigned int helpers = std::min(state->chunks - 1, size());
+        for (unsigned int i = 0; i < helpers; i++)
+            submit([state]() { state->run(); });
+        state->run();
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->finished.wait(lock, [&state]() { return state->completed.load() == state->chunks; });
+    }
+
+    unsigned int size() const
+    {
+        return (unsigned int)workers.size();
+    }
+
+private:
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> jobs;
+    };
+    //Shared between the caller and helper jobs of one parallelFor, outlives the call if a helper starts late
+    struct ParallelFor
+    {
+        unsigned int count = 0;
+        unsigned int grain = 1;
+        unsigned int chunks = 0;
+        std::function<void(unsigned int, unsigned int)> body;
+        std::atomic<unsigned int> nextChunk{ 0 };
+        std::atomic<unsigned int> completed{ 0 };
+        std::mutex mutex;
+        std::condition_variable finished;
+
+        void run()
+        {
+            while (true)
+            {
+                unsigned int chunk = nextChunk.fetch_add(1);
+                if (chunk >= chunks)
+                    return;
+                unsigned int begin = chunk * grain;
+                unsigned int end = std::min(begin + grain, count);
+                body(begin, end);
+                if (completed.fetch_add(1) + 1 == chunks)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    finished.notify_all();
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::atomic<unsigned int> nextQueue{ 0 };
+    //Jobs sitting in any queue, workers sleep while it's zero
+    std::atomic<unsigned int> queued{ 0 };
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<bool> stopping{ false };
+
+    //Which pool and worker the calling thread belongs to, null/0 for threads outside any pool
+    static ThreadPool*& currentPool()
+    {
+        thread_local ThreadPool* pool = nullptr;
+        return pool;
+    }
+    static unsigned int& currentWorker()
+    {
+        thread_local unsigned int worker = 0;
+        return worker;
+    }
+
+    //Own queue from the back, then everyone else's from the front
+    bool takeJob(unsigned int index, std::function<void()>& job)
+    {
+        {
+            WorkerQueue& own = *queues[index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.jobs.empty())
+            {
+                job = std::move(own.jobs.back());
+                own.jobs.pop_back();
+                return true;
+            }
+        }
+        for (unsigned int i = 1; i < queues.size(); i++)
+        {
+            WorkerQueue& victim = *queues[(index + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.jobs.empty())
+            {
+                job = std::move(victim.jobs.front());
+                victim.jobs.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(unsigned int index)
+    {
+        currentPool() = this;
+        currentWorker() = index;
+        while (!stopping.load())
+        {
+            std::function<void()> job;
+            if (takeJob(index, job))
+            {
+                queued.fetch_sub(1);
+                job();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this]() { return stopping || queued.load() > 0; });
+        }
+    }
+};
+
+#endif
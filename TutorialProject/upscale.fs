@@ -0,0 +1,30 @@
+#version 330 core
+//Scene upscale: bilinear from the rendered corner of the scene target, then a cross shaped unsharp mask to win back some of
+//the detail the lower resolution lost. The result is clamped to the taps' range so edges don't ring
+out vec4 FragColor;
+
+uniform sampler2D scene;
+//Rendered size over the scene texture size, the part of it holding this frame
+uniform vec2 uvScale;
+//Output size in pixels
+uniform vec2 outputSize;
+//0 is plain bilinear
+uniform float sharpness;
+
+void main()
+{
+    vec2 texel = 1.0 / vec2(textureSize(scene, 0));
+    //Taps stay inside the rendered region, past it is whatever an earlier frame at a larger scale left
+    vec2 low = texel * 0.5;
+    vec2 high = uvScale - texel * 0.5;
+    vec2 uv = gl_FragCoord.xy / outputSize * uvScale;
+    vec3 center = texture(scene, clamp(uv, low, high)).rgb;
+    vec3 left = texture(scene, clamp(uv - vec2(texel.x, 0.0), low, high)).rgb;
+    vec3 right = texture(scene, clamp(uv + vec2(texel.x, 0.0), low, high)).rgb;
+    vec3 down = texture(scene, clamp(uv - vec2(0.0, texel.y), low, high)).rgb;
+    vec3 up = texture(scene, clamp(uv + vec2(0.0, texel.y), low, high)).rgb;
+    vec3 minimum = min(center, min(min(left, right), min(down, up)));
+    vec3 maximum = max(center, max(max(left, right), max(down, up)));
+    vec3 sharpened = center + (4.0 * center - left - right - down - up) * 0.25 * sharpness;
+    FragColor = vec4(clamp(sharpened, minimum, maximum), 1.0);
+}